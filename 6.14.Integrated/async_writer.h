@@ -0,0 +1,124 @@
+/*
+ * Buffered output stream whose buffers are written out by a background thread.
+ * Author - Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include "common.h"
+#include <ostream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+namespace util {
+
+// appends go into the current buffer; once it holds chunk bytes it is queued for the
+// writer thread and an empty buffer takes its place. at most 'buffers' buffers exist,
+// so a slow stream only blocks the producer when all of them are full.
+// not thread safe on the producer side, there has to be a single producer.
+class AsyncWriter {
+    protected: std::ostream &os;
+    protected: const size_t chunk;
+    protected: std::vector<std::string> pool;   // all buffers
+    protected: std::vector<unsigned int> queue; // buffers to write, in order
+    protected: std::vector<unsigned int> spare; // empty buffers
+    protected: unsigned int current;            // buffer being filled
+    protected: bool closing, running, failed;
+    protected: pthread_t thread;
+    protected: pthread_mutex_t mutex;
+    protected: pthread_cond_t cond_queue, cond_spare;
+
+    public: AsyncWriter(std::ostream &os_, const size_t chunk_ = 1 << 20, const unsigned int buffers = 4)
+      : os(os_), chunk(chunk_), pool(buffers < 2 ? 2 : buffers), current(0), closing(false), running(false), failed(false) {
+        for (unsigned int i=1; i<pool.size(); ++i) spare.push_back(i);
+        pool[0].reserve(chunk + chunk / 8);
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond_queue, NULL);
+        pthread_cond_init(&cond_spare, NULL);
+        if (pthread_create(&thread, NULL, writer_main, this) != 0) ERROR_exit("cannot create writer thread");
+        running = true;
+    }
+
+    public: ~AsyncWriter() {
+        close();
+        pthread_cond_destroy(&cond_spare);
+        pthread_cond_destroy(&cond_queue);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    public: inline void write(const std::string &s) {
+        pool[current] += s;
+        if (pool[current].size() >= chunk) submit();
+    }
+    public: inline void write(const char c) {
+        pool[current] += c;
+        if (pool[current].size() >= chunk) submit();
+    }
+
+    // write out everything and stop the writer thread; false if the stream failed
+    public: bool close() {
+        if (running) {
+            if (!pool[current].empty()) submit();
+            pthread_mutex_lock(&mutex);
+            closing = true;
+            pthread_cond_signal(&cond_queue);
+            pthread_mutex_unlock(&mutex);
+            pthread_join(thread, NULL);
+            running = false;
+            os.flush();
+        }
+        return !failed && os.good();
+    }
+
+    // queue the current buffer and continue with a spare one
+    protected: void submit() {
+        pthread_mutex_lock(&mutex);
+        queue.push_back(current);
+        pthread_cond_signal(&cond_queue);
+        while (spare.empty()) pthread_cond_wait(&cond_spare, &mutex);
+        current = spare.back();
+        spare.pop_back();
+        pthread_mutex_unlock(&mutex);
+    }
+
+    protected: static void *writer_main(void *p) {
+        static_cast<AsyncWriter*>(p)->writer();
+        return NULL;
+    }
+
+    protected: void writer() {
+        pthread_mutex_lock(&mutex);
+        for (;;) {
+            while (queue.empty() && !closing) pthread_cond_wait(&cond_queue, &mutex);
+            if (queue.empty()) break; // closing and nothing left
+            const unsigned int b = queue.front();
+            queue.erase(queue.begin());
+            pthread_mutex_unlock(&mutex);
+            std::string &buf = pool[b];
+            if (!failed) {
+                os.write(buf.data(), buf.size());
+                if (!os.good()) failed = true;
+            }
+            buf.clear(); // keeps the capacity
+            pthread_mutex_lock(&mutex);
+            spare.push_back(b);
+            pthread_cond_signal(&cond_spare);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+};
+
+} // end namespace
+
+#endif
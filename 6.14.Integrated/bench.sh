@@ -0,0 +1,107 @@
+#!/bin/sh
+# Benchmarks of GatorADD, run by "make bench" and "make bench-baseline" with the optimized
+# build GatorADD_bench.
+# usage - ./bench.sh gatoradd bench_gen [baseline]
+# Runs the shipped datasets and generated trees of BENCH_SIZES tips in every add mode,
+# BENCH_REPLICATES replicates each, and writes one line per workload to bench_results.txt:
+# replicates/s, peak RSS and the main phases from the --stats report of GatorADD.
+# With "baseline" the results are saved to bench_baseline.txt, otherwise they are compared
+# with it: a workload whose replicates/s fall or whose peak RSS grows by more than
+# BENCH_TOLERANCE (a fraction, default 0.2) is a regression and the script exits with 1.
+# replicates/s of workloads that took less than BENCH_MIN_SECONDS (default 0.5) in the
+# baseline are too noisy and not compared.
+
+GATORADD=$1
+BENCH_GEN=$2
+case $GATORADD in */*) ;; *) GATORADD=./$GATORADD ;; esac
+case $BENCH_GEN in */*) ;; *) BENCH_GEN=./$BENCH_GEN ;; esac
+BENCH_SIZES=${BENCH_SIZES:-"1000 10000 100000 1000000"}
+BENCH_REPLICATES=${BENCH_REPLICATES:-5}
+BENCH_TOLERANCE=${BENCH_TOLERANCE:-0.2}
+BENCH_THREADS=${BENCH_THREADS:-1}
+BENCH_MIN_SECONDS=${BENCH_MIN_SECONDS:-0.5}
+RESULTS=bench_results.txt
+BASELINE=bench_baseline.txt
+WORK=bench_work
+
+if [ ! -x "$GATORADD" ] || [ ! -x "$BENCH_GEN" ]; then
+  echo "usage - ./bench.sh gatoradd bench_gen [baseline]"
+  exit 1
+fi
+mkdir -p $WORK || exit 1
+
+# value of "key": in the line of the report starting with prefix
+value() {
+  sed -n "/^$2/s/.*\"$3\": {*\"*seconds\"*:* *\([0-9.e+-]*\).*/\1/p" $1 | head -1
+}
+phase() {
+  v=`value $1 ' "phases"' $2`
+  if [ -z "$v" ]; then echo -; else awk -v v=$v 'BEGIN { printf "%.3g", v }'; fi
+}
+
+printf "%-24s %9s %8s %10s %12s %11s %9s %9s %9s %9s %9s\n" workload tips taxa seconds replicates/s peak_rss_kb parse lca sample graft serialize > $RESULTS
+
+# bench name tree leaves
+bench() {
+  name=$1
+  echo "$name" >&2
+  if ! $GATORADD $2 $3 $BENCH_REPLICATES $WORK/out.txt --seed 1 -j $BENCH_THREADS -v 0 --stats $WORK/$name.json > /dev/null; then
+    echo "$name failed" >&2
+    exit 1
+  fi
+  r=$WORK/$name.json
+  tips=`sed -n 's/.*"leaves": \([0-9]*\).*/\1/p' $r`
+  taxa=`sed -n 's/.*"taxa": \([0-9]*\).*/\1/p' $r`
+  seconds=`sed -n 's/^ "seconds": \([0-9.e+-]*\).*/\1/p' $r`
+  rs=`sed -n 's/^ "replicates_seconds": \([0-9.e+-]*\).*/\1/p' $r`
+  rss=`sed -n 's/^ "peak_rss_kb": \([0-9]*\).*/\1/p' $r`
+  rate=`awk -v n=$BENCH_REPLICATES -v s=$rs 'BEGIN { printf "%.4g", (s > 0) ? n / s : 0 }'`
+  printf "%-24s %9s %8s %10.3f %12s %11s %9s %9s %9s %9s %9s\n" $name $tips $taxa $seconds $rate $rss \
+    `phase $r newick_parse` `phase $r lca_create` `phase $r sample_edge` `phase $r graft` `phase $r serialize` >> $RESULTS
+}
+
+# shipped datasets
+D=datasets
+bench jum_fam_stem $D/JUM_Opt.R8s.tre $D/MissingTaxa.ED.txt
+bench jum_random $D/JUM_Opt.R8s.tre $D/rMissingTaxa.ED.txt
+bench antbird_stem $D/Antbird.TEST.tre $D/MIssingAntbird.unix.txt
+bench vbig2_random_nobl $D/vbig2_ordered.tre $D/rMissingTaxa.ED.txt
+head -1 $D/15_80_10.txt > $WORK/15_80_10.tre
+$BENCH_GEN 2 10 RANDOM $WORK/unused.tre $WORK/15_80_10_add.txt || exit 1
+bench 15_80_10_random_nobl $WORK/15_80_10.tre $WORK/15_80_10_add.txt
+
+# generated trees, a tenth of the tips is added
+for n in $BENCH_SIZES; do
+  for mode in RANDOM STEM CROWN FAM_STEM FAM_CROWN; do
+    $BENCH_GEN $n `expr $n / 10` $mode $WORK/gen.tre $WORK/gen_add.txt || exit 1
+    bench gen_${n}_$mode $WORK/gen.tre $WORK/gen_add.txt
+  done
+done
+rm -f $WORK/out.txt $WORK/gen.tre $WORK/gen_add.txt $WORK/15_80_10.tre $WORK/unused.tre $WORK/15_80_10_add.txt
+
+cat $RESULTS
+if [ "$3" = "baseline" ]; then
+  cp $RESULTS $BASELINE
+  echo "saved as $BASELINE"
+  exit 0
+fi
+if [ ! -f $BASELINE ]; then
+  echo "no $BASELINE to compare with, run make bench-baseline first"
+  exit 0
+fi
+
+# compare replicates/s (column 5) and peak RSS (column 6) with the baseline
+awk -v tol=$BENCH_TOLERANCE -v min=$BENCH_MIN_SECONDS '
+  FNR == 1 { next }
+  NR == FNR { seconds[$1] = $4; rate[$1] = $5; rss[$1] = $6; next }
+  !($1 in rate) { next }
+  {
+    status = "ok"
+    if (seconds[$1] < min) status = "ok (too short to time)"
+    else if ($5 < rate[$1] * (1 - tol)) status = "SLOWER"
+    if ($6 > rss[$1] * (1 + tol)) status = (status == "SLOWER") ? status ", MORE MEMORY" : "MORE MEMORY"
+    printf "%-24s replicates/s %10s -> %-10s peak_rss_kb %9s -> %-9s %s\n", $1, rate[$1], $5, rss[$1], $6, status
+    if (status ~ /SLOWER|MEMORY/) bad++
+  }
+  END { if (bad) { print bad " regression(s)"; exit 1 } print "no regressions" }
+' $BASELINE $RESULTS
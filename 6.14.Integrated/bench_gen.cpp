@@ -0,0 +1,95 @@
+/* Workload generator for the benchmarks (make bench)
+ * Author - Avinash Ramu
+ * usage - ./bench_gen tips taxa mode tree_file leaves_file [seed]
+ * Writes a random ultrametric binary tree with the given number of tips to tree_file and
+ * a leaves file adding taxa new taxa with the given mode to leaves_file.
+ * mode is RANDOM, STEM, CROWN, FAM_STEM or FAM_CROWN
+ * Tip i is named F<f>_t<i> with f = i/50, so every block of 50 tips in tree order forms the
+ * family F<f>_ for the FAMILY modes.
+ */
+
+#include "random.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+static const unsigned int FAMILY_SIZE = 50;
+
+// newick of the tips [lo,hi) below a node of height h, the length of its edge is up
+void subtree(ostream &os, util::RandomStream &rng, const unsigned int lo, const unsigned int hi, const double h, const double up) {
+  char buf[64];
+  if (hi - lo == 1) {
+    snprintf(buf, sizeof(buf), "F%u_t%u:%.6g", lo / FAMILY_SIZE, lo, up);
+    os << buf;
+    return;
+  }
+  const unsigned int mid = lo + 1 + rng.uniform(hi - lo - 1);
+  const double h1 = mid - lo == 1 ? 0 : h * (0.3 + 0.6 * rng.uniform());
+  const double h2 = hi - mid == 1 ? 0 : h * (0.3 + 0.6 * rng.uniform());
+  os << '(';
+  subtree(os, rng, lo, mid, h1, h - h1);
+  os << ',';
+  subtree(os, rng, mid, hi, h2, h - h2);
+  os << ')';
+  if (up >= 0) {
+    snprintf(buf, sizeof(buf), ":%.6g", up);
+    os << buf;
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  if(argc<6){
+    cout<<"Incorrect Arguments ! Exiting! \n\t usage - ./bench_gen tips taxa mode tree_file leaves_file [seed]\n";
+    exit(1);
+  }
+  const unsigned int tips = atoi(argv[1]);
+  const unsigned int taxa = atoi(argv[2]);
+  const string mode = argv[3];
+  const uint64_t seed = argc > 6 ? strtoull(argv[6], NULL, 10) : 1;
+  if (tips < 2) {
+    cout<<"The tree needs at least 2 tips! Exiting!\n";
+    exit(1);
+  }
+  if (mode != "RANDOM" && mode != "STEM" && mode != "CROWN" && mode != "FAM_STEM" && mode != "FAM_CROWN") {
+    cout<<"Unknown mode "<<mode<<" ! Exiting!\n";
+    exit(1);
+  }
+
+  util::RandomStream rng(seed, 0);
+  {
+    ofstream ofs(argv[4]);
+    subtree(ofs, rng, 0, tips, 100, -1);
+    ofs << ";\n";
+    if (!ofs.good()) {
+      cout<<"Unable to write tree file! Exiting!\n";
+      exit(1);
+    }
+  }
+
+  ofstream ofs(argv[5]);
+  const unsigned int families = (tips + FAMILY_SIZE - 1) / FAMILY_SIZE;
+  for (unsigned int j=0; j<taxa; j++) {
+    if (mode == "RANDOM") {
+      ofs << "new" << j << "\tRANDOM\n";
+    } else if (mode == "STEM" || mode == "CROWN") {
+      // a clade of about 1/20 of the tree
+      const unsigned int a = rng.uniform(tips);
+      const unsigned int b = (a + 1 + rng.uniform(tips / 20 + 1)) % tips;
+      ofs << "new" << j << "\tF" << a / FAMILY_SIZE << "_t" << a << "\tF" << b / FAMILY_SIZE << "_t" << b << '\t' << mode << '\n';
+    } else {
+      const unsigned int f = rng.uniform(families);
+      ofs << 'F' << f << "_new" << j << "\tF" << f << '_' << (mode == "FAM_CROWN" ? "\tCROWN" : "") << '\n';
+    }
+  }
+  if (!ofs.good()) {
+    cout<<"Unable to write leaves file! Exiting!\n";
+    exit(1);
+  }
+  return 0;
+}
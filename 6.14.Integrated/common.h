@@ -7,14 +7,22 @@
 #include <cstdlib>
 
 // stream for normal messages
+// the log file is only created by the first message
 class StdOut {
     private: std::ofstream log_file;
-    public: StdOut(const bool &logging_) : logging(logging_) {
-        quiet = false;
+    private: bool log_open;
+    private: bool open_log() {
+        if (!logging) return false;
         #ifdef WITH_MPI
         if (mpi_rank == 0)
         #endif
-        if (logging) log_file.open("data_log.txt");
+        if (!log_open) log_file.open("data_log.txt");
+        log_open = true;
+        return true;
+    }
+    public: StdOut(const bool &logging_) : logging(logging_) {
+        quiet = false;
+        log_open = false;
     }
     public: inline StdOut& operator<<(std::ostream& (*r)(std::ostream&))
 {
@@ -22,7 +30,7 @@ class StdOut {
         #ifdef WITH_MPI
         if (mpi_rank == 0)
         #endif
-        if (logging) log_file << r;
+        if (open_log()) log_file << r;
         return *this;
     }
     public: template<class T> inline StdOut& operator<<(const T &r)
@@ -31,7 +39,7 @@ class StdOut {
         #ifdef WITH_MPI
         if (mpi_rank == 0)
         #endif
-        if (logging) log_file << r;
+        if (open_log()) log_file << r;
         return *this;
     }
     public: const bool logging;
@@ -0,0 +1,112 @@
+/* Expander of the binary delta output of GatorADD (--binary)
+ * Author - Avinash Ramu using Andre Wehe's TREE Library
+ * usage - ./GatorExpand delta_file opfile [--replicate K]
+ * Writes the replicates stored in delta_file as newick trees to opfile, one per line, the
+ * same trees GatorADD writes without --binary.
+ * Options
+ *    -r [ --replicate ] K only write replicate K (numbered from 1)
+ */
+
+#include "common.h"
+#include "argument.h"
+#include "tree.h"
+#include "tree_binary.h"
+#include "tree_IO.h"
+#include "tree_traversal.h"
+#include "tree_overlay.h"
+#include "tree_newick.h"
+#include "async_writer.h"
+#include "replicate_delta.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+
+  if(argc<3){
+    cout<<"Incorrect Arguments ! Exiting! \n\t usage - ./GatorExpand delta_file opfile [--replicate K]\n";
+    exit(1);
+  }
+
+  unsigned int only = 0; // 0: all replicates
+  {
+    Argument a; a.add(argc-2, argv+2);
+    if (a.existArgVal2("-r", "--replicate", only) && only == 0) MSG_exit("replicates are numbered from 1");
+    a.unusedArgsError();
+  }
+
+  ifstream ifs(argv[1], ios::in | ios::binary);
+  if(!ifs.good()) {
+    cout<<"Unable to open delta file! Exiting!\n";
+    exit(1);
+  }
+  delta::Reader reader(ifs);
+  if (!reader.read_header()) {
+    cout<<"Not a GatorADD delta file! Exiting!\n";
+    exit(1);
+  }
+
+  // the initial tree, parsed like GatorADD did so the node numbers agree
+  aw::BinaryTree initial_t;
+  aw::idx2name initial_t_name;
+  aw::idx2weight_double initial_t_weight;
+  if (!aw::text2tree(reader.tree_text, initial_t, initial_t_name, initial_t_weight)) {
+    cout<<"Unable to read tree from delta file! Exiting!";
+    exit(1);
+  }
+  const unsigned int n = initial_t.node_size();
+  vector<unsigned int> initial_parents(n);
+  for (unsigned int v=0; v<n; ++v) initial_parents[v] = initial_t.parent(v);
+  initial_t_weight.fill(n); // GatorADD gives every edge without a length one of 0 (the root's)
+
+  aw::NewickLabels labels;
+  labels.create(initial_t, initial_t_name, initial_t_weight, reader.precision);
+
+  ofstream ofs(argv[2]);
+  if(!ofs.good()) {
+    cout << "unable to open output file!";
+    exit(1);
+  }
+  util::AsyncWriter out(ofs);
+
+  aw::TreeOverlay<aw::BinaryTree, aw::idx2weight_double> t;
+  t.create(initial_t, initial_t_weight, n + 2 * reader.taxa.size());
+  vector<string> newick_names(reader.taxa.size()); // the taxa escaped for newick, the overlay keeps their addresses
+  for (unsigned int j=0,jEE=reader.taxa.size(); j<jEE; ++j) newick_names[j] = NS_input::getlegalstring(reader.taxa[j]);
+  vector<unsigned int> parents;
+  vector<delta::Graft> grafts;
+  string tree;
+  unsigned int k, written = 0;
+  while (reader.read_replicate(k, grafts)) {
+    if (only != 0 && k != only) continue;
+    t.reset();
+    parents.assign(initial_parents.begin(), initial_parents.end()); // O(n) like the newick output
+    for (unsigned int j=0,jEE=grafts.size(); j<jEE; ++j) {
+      const delta::Graft &g = grafts[j];
+      if (g.edge >= parents.size() || parents[g.edge] == aw::NONODE) ERROR_exit("replicate " << k << " splits an edge that does not exist");
+      const unsigned int parent = parents[g.edge];
+      const unsigned int i_n = t.graft(g.edge, parent, g.offset, g.pendant, newick_names[g.taxon]);
+      parents[g.edge] = i_n;
+      parents.push_back(parent); // i_n
+      parents.push_back(i_n);    // l_n
+    }
+    tree.clear();
+    t.newick(tree, labels);
+    out.write(tree);
+    out.write('\n');
+    ++written;
+  }
+  if (!out.close()) {
+    cout << "unable to write output file!";
+    exit(1);
+  }
+  if (only != 0 && written == 0) {
+    cout<<"Replicate "<<only<<" is not in the delta file! Exiting!\n";
+    exit(1);
+  }
+  cout<<written<<" trees written\n";
+  return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Reader of the file of leaves to add: one taxon per line with up to 3 more tab
+ * separated fields (RANDOM, a family with CROWN/STEM, or 2 bases with CROWN/STEM).
+ * Author - Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef LEAVES_FILE_H
+#define LEAVES_FILE_H
+
+#include "mapped_file.h"
+#include <string>
+#include <vector>
+#include <string.h>
+
+namespace util {
+
+// one line of the leaves file
+struct LeavesRow {
+    unsigned int line;     // line number, from 1
+    std::string field[4];  // missing fields are empty
+};
+
+// split the whole file into rows in one pass over the mapped bytes
+// fields after the 4th are ignored, a '\r' at the end of a line (DOS line ends) is dropped,
+// empty lines are skipped and the last line does not need a line end
+// false if the file cannot be read
+inline bool read_leaves_file(const char *path, std::vector<LeavesRow> &rows) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    rows.clear();
+    const char *p = file.begin(), *end = file.end();
+    unsigned int line = 0;
+    while (p < end) {
+        ++line;
+        const char *eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (eol == NULL) eol = end;
+        const char *e = eol;
+        if ((e > p) && (e[-1] == '\r')) --e;
+        if (e > p) {
+            rows.push_back(LeavesRow());
+            LeavesRow &row = rows.back();
+            row.line = line;
+            for (unsigned int i=0; (i<4) && (p<=e); ++i) {
+                const char *tab = static_cast<const char*>(memchr(p, '\t', e - p));
+                if (tab == NULL) tab = e;
+                row.field[i].assign(p, tab);
+                p = tab + 1;
+            }
+        }
+        p = eol + 1;
+    }
+    return true;
+}
+
+} // end namespace
+
+#endif
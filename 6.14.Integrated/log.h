@@ -0,0 +1,79 @@
+/*
+ * Messages with verbosity levels. Levels above LOG_MAX_LEVEL are compiled out,
+ * the others are checked against the level chosen at run time.
+ * Author - Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <sstream>
+#include <string>
+
+// highest level that is compiled in, release builds (-DNDEBUG) drop the verbose and debug messages
+#ifndef LOG_MAX_LEVEL
+#ifdef NDEBUG
+#define LOG_MAX_LEVEL 1
+#else
+#define LOG_MAX_LEVEL 3
+#endif
+#endif
+
+namespace util {
+
+enum {
+    LOG_LEVEL_QUIET = 0,   // errors only, they are not written through this layer
+    LOG_LEVEL_INFO = 1,    // summary of the input and of every replicate
+    LOG_LEVEL_VERBOSE = 2, // every line of the input
+    LOG_LEVEL_DEBUG = 3    // every insertion
+};
+
+// level chosen at run time
+inline unsigned int &log_level() {
+    static unsigned int level = LOG_LEVEL_INFO;
+    return level;
+}
+
+// messages of a thread collected for being written out later by a single thread,
+// so workers never share a stream; the buffer is kept between take()s
+class LogBuffer {
+    protected: std::ostringstream os;
+
+    // copies start empty, so buffers can be kept in containers
+    public: LogBuffer() {}
+    public: LogBuffer(const LogBuffer &) {}
+    public: LogBuffer& operator=(const LogBuffer &) { return *this; }
+
+    public: template<class T> inline LogBuffer& operator<<(const T &v) {
+        os << v;
+        return *this;
+    }
+
+    // move the messages to out and empty the buffer
+    public: inline void take(std::string &out) {
+        out = os.str();
+        os.str(std::string());
+    }
+};
+
+} // end namespace
+
+// write msg_arg to sink (an ostream or a LogBuffer) if level is enabled
+// the condition is a constant for levels above LOG_MAX_LEVEL, so the message is not compiled in
+#define LOG(level, sink, msg_arg) { \
+    if (((level) <= LOG_MAX_LEVEL) && ((unsigned int)(level) <= util::log_level())) { sink << msg_arg; } \
+}
+#define LOG_INFO(sink, msg_arg) LOG(util::LOG_LEVEL_INFO, sink, msg_arg)
+#define LOG_VERBOSE(sink, msg_arg) LOG(util::LOG_LEVEL_VERBOSE, sink, msg_arg)
+#define LOG_DEBUG(sink, msg_arg) LOG(util::LOG_LEVEL_DEBUG, sink, msg_arg)
+
+#endif
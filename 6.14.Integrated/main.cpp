@@ -1,8 +1,8 @@
 /* STEM MRCA Version 1
  * Author - Avinash Ramu using Andre Wehe's TREE Library, Feb 11 2011
- * sample usage -  ./exec tree_file leaves_file replicates opfile
+ * sample usage -  ./exec tree_file leaves_file replicates opfile [--threads N] [--seed S]
  * This is a program to add taxa of specified family to a tree depending on branch lengths at all edges including stem.
- * usage - ./executable initial_tree_file leaves_families_file no_of_replicates opfile_name 
+ * usage - ./executable initial_tree_file leaves_families_file no_of_replicates opfile_name [options]
  * STEM is default, Stem/Crown can be specified by the user
  * Option 1 ( Specify the two species whose LCA is the root of subtree to insert)
  *    TaxonName Species1 Species2 Stem/Crown
@@ -11,18 +11,51 @@
  * Option 3 ( Specify a part of the Species Name)
  *    TaxonName  Part_of_species_name
  * Option 4 ( Insert anywhere in the tree )
- *    TaxonName RANDOM  
+ *    TaxonName RANDOM
+ * Options
+ *    -j [ --threads ] N   build replicates on N threads, the output stays in replicate order
+ *    -s [ --seed ] S      seed of the random number generator (default: current time)
+ *    -f [ --first ] K     number of the first replicate (default: 1), e.g. "--seed S --first K" with
+ *                         1 replicate rebuilds replicate K of an earlier run with seed S
+ *    -p [ --precision ] P significant digits of the branch lengths in the output (default: 6)
+ *    -b [ --binary ]      write the initial tree once and every replicate as its list of grafts
+ *                         (binary delta format, see replicate_delta.h); GatorExpand turns it into newick
+ *    -a [ --all-trees ]   build the replicates of every tree of tree_file (e.g. a posterior sample),
+ *                         not only of the first one; the output holds the replicates of the first tree,
+ *                         then the ones of the second, ... and the threads share the work of all trees
+ *    -v [ --verbosity ] V messages on the screen: 0 none, 1 summary (default), 2 every input line,
+ *                         3 every insertion (2 and 3 are not compiled into builds with -DNDEBUG)
+ *    --stats FILE         write wall times and call counts of the phases and the numbers of
+ *                         replicates and insertions, in total and per replicate, to FILE as JSON
+ *    --progress SECONDS   print the number of finished replicates, their rate and the ETA to
+ *                         stderr at most every SECONDS seconds
  */
- 
- 
+
+
 extern const char *builddate;
 #include "common.h"
 #include "argument.h"
 #include "tree.h"
+#include "tree_binary.h"
 #include "tree_IO.h"
 #include "tree_traversal.h"
 #include "tree_subtree_info.h"
 #include "tree_LCA.h"
+#include "tree_edge_sampler.h"
+#include "tree_tour.h"
+#include "tree_family_index.h"
+#include "tree_LCA_dynamic.h"
+#include "tree_overlay.h"
+#include "touched.h"
+#include "tree_newick.h"
+#include "async_writer.h"
+#include "replicate_delta.h"
+#include "log.h"
+#include "stats.h"
+#include "mapped_file.h"
+#include "leaves_file.h"
+#include "parallel.h"
+#include "random.h"
 #include <iostream>
 #include <fstream>
 #include <map>
@@ -31,557 +64,829 @@ extern const char *builddate;
 #include <string>
 #include <algorithm>
 #include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/algorithm/string.hpp> // for stricmp()
 #include <math.h>
 
-#define MAX_LEAF_ADD 1000 /* Max Number of new leaves that can be added */ 
 #define ADDED 1
 #define NOT_ADDED 0
-#define MAX_TREE_SIZE 2000 /* Max number of taxa in the input tree */
-#define MAX_FAMILY 2000
 
 using namespace std;
-int binarysearch(double *BLs, int size, double key);
 
-int main(int argc, char* argv[]) { 
-  
-  if(argc!=5){
-    cout<<"Incorrect Arguments ! Exiting! \n\t usage - ./exec tree_file leaves_file replicates opfile\n";
-    exit(1);
-  }
- 
-  // set seed of Rand number generator 
-  srand(time(NULL));
-  
-  // ADD OPTION types
-  enum{CROWN, STEM, FAM_CROWN, FAM_STEM};
-  
-  // INVALID LCA ARRAY VALUE
-  const int INVALID = -1;
-  
-  // Read in command line arguments 
-  char* treefile = argv[1];
-  char* leaves_file = argv[2];  
-  unsigned int   replicates = atoi(argv[3]);
-  char* opfile = argv[4];
-  
-  // Map name of the families to family id 
-  map<std::string, int> fam2id;
-  
-  // Read initial starting tree from treefile
-  std::ifstream ifs;
-  ifs.open (treefile);
-  aw::Tree initial_t;
-  aw::idx2name initial_t_name;
-  aw::idx2weight_double initial_t_weight;   
-  if(ifs.good()) {       
-    if (!aw::stream2tree(ifs, initial_t, initial_t_name, initial_t_weight)) {
-      cout<<"Unable to read tree from file! Exiting!";
-      exit(1);
-    }    	
-  } else {
-    cout<<"Unable to open tree file! Exiting!\n";
-    exit(1);
-  }   
-  
-  // Open output file 
-  ofstream ofs(opfile);
-  if(!ofs.good()) {
-    cout << "unable to open output file!";
-    exit(1);
-  } 
-  
-  // Set the maximum total number of leaves 
-  const unsigned int MAX_TOTAL_NODES = 2*(MAX_TREE_SIZE + MAX_LEAF_ADD -1);
-  
-  //Parent array and translate array for nodes 
-  int*    initial_parents = new int[MAX_TOTAL_NODES];
-  unsigned int* translate_index = new unsigned int[MAX_TOTAL_NODES];
-  
-  // Number of leaves and nodes(internal + leaf) 
-  int leafn = 0;
-  int initial_nodecount = 0;
-    
-  // Map name of the leaves to their id 
-  map<std::string, int> name2id;
-  
-  // Create a vector of all leaf names 
-  std::vector<std::string> leaves; 
-  
-  double initialBL = 0;
-  
-  // Traverse the initial tree to create parents array  and leaves vector
-  TREE_POSTORDER2(k,initial_t){
-    unsigned int currnode = k.idx;
-    //cout<<" "<<currnode<<initial_t_name[currnode];
-    if(initial_t.is_leaf(currnode)) {
-      string leaf = initial_t_name[currnode];
-      name2id[leaf] = currnode;
-      leaves.push_back(leaf);
-      leafn++;
-    }    
-    initial_nodecount++;
-    initial_parents[currnode] = k.parent;
-    initialBL += initial_t_weight[currnode][0];
-  } 
-  
-  
-  cout<<"\nThe number of leaves in the initial tree is "<<leafn;
-  cout<<"\nThe initial total Branch Length is "<<initialBL;
-  
-  
-  // Create an lca object to find lcas of nodes.
-  aw::LCA lca;
-  lca.create(initial_t);
-     
-  //Map of family for taxa
-  map<std::string, std::string>families;
-    
-  // Create an array to store the lca values of individual nodes
-  int initial_lcas_index[MAX_TOTAL_NODES];
-  int initial_lcas[MAX_TOTAL_NODES];
-  int ADDoption[MAX_LEAF_ADD];//the option specified for the leaf
-  string leaves_array[MAX_LEAF_ADD];//store all leaves to be added
-    
-  // Read in leaves to be added from file 
-  int leafcount = 0;  //number of leaves to be added.
-  std::ifstream ifs2(leaves_file);
-  string current_leaf;
-  if(!ifs2.is_open()) {
-    cout<<"\nUnable to open leaves to be added file !";
-    exit(1);
-  }
-  else {
-    getline(ifs2 ,current_leaf);
-    cout<<"\n\nReading in Leaves and LCAs";    
-    while(ifs2.good()) {  
-        
-      string token1, token2, token3, token4;
-      
-      // Parse the leaf and options 
-      istringstream iss(current_leaf);
-      getline(iss, token1, '\t');
-      getline(iss, token2, '\t');
-      getline(iss, token3, '\t');
-      getline(iss, token4, '\t');
-      
-      cout<<"\n Token 1 "<<token1<<" Token2 "<<token2<<" Token3 "<<token3<<" Token4 "<<token4<<" DONE";
-      
-      string taxa, base1, base2, familyName;
-      
+// ADD OPTION types
+enum{CROWN, STEM, FAM_CROWN, FAM_STEM};
+
+// INVALID LCA ARRAY VALUE
+static const int INVALID = -1;
+
+// Phases and counters of the --stats report; the phases of the replicates are summed over
+// the threads, so together they can take longer than the run
+enum{PHASE_PARSE, PHASE_PARENTS, PHASE_LCA, PHASE_LEAVES, PHASE_FAMILIES, PHASE_SETUP,
+     PHASE_RESET, PHASE_PICK, PHASE_SAMPLE, PHASE_GRAFT, PHASE_FAMILY_ROOTS, PHASE_SERIALIZE, PHASE_WRITE, PHASES};
+static const char *const phase_names[PHASES] = {"newick_parse", "parents_and_heights", "lca_create", "leaves_file",
+    "family_index", "setup", "replicate_reset", "pick_taxon", "sample_edge", "graft", "family_roots", "serialize", "write"};
+enum{COUNT_REPLICATES, COUNT_INSERTIONS, COUNTERS};
+static const char *const counter_names[COUNTERS] = {"replicates", "insertions"};
+
+// Errors found in the leaves file, with the line they are on
+typedef vector<pair<unsigned int, string> > input_errors;
+
+// print the errors in line order and exit if there are any
+static void exit_on_errors(input_errors &errors, const string &where) {
+  if (errors.empty()) return;
+  const unsigned int MAX_ERRORS_SHOWN = 100;
+  sort(errors.begin(), errors.end()); // one error per line
+  cout<<"\nInvalid Input in "<<where<<" !";
+  for (unsigned int i=0; i<errors.size() && i<MAX_ERRORS_SHOWN; i++) cout<<"\nline "<<errors[i].first<<": "<<errors[i].second;
+  if (errors.size() > MAX_ERRORS_SHOWN) cout<<"\n... "<<errors.size() - MAX_ERRORS_SHOWN<<" more";
+  cout<<"\n"<<errors.size()<<" invalid line(s) ! Exiting !"<<endl;
+  exit(1);
+}
+
+// The leaves to be added as read from the leaves file, the same for every input tree
+class Taxa {
+  public: vector<util::LeavesRow> rows;          // the leaves file
+  public: vector<int> ADDoption;                 // the option specified for the leaf
+  public: vector<string> leaves_array;           // store all leaves to be added
+  public: vector<const string*> newick_name;     // the leaves escaped for newick, in the name pool
+  public: vector<unsigned int> row;              // row of every leaf, for its bases
+  public: aw::FamilyIndex family_index;          // names of the families, the clades are located per tree
+  public: vector<unsigned int> family_id;        // family of every leaf to be added
+  public: vector<vector<unsigned int> > taxon_families; // families whose name is part of the leaf name
+  public: int leafcount;                         // number of leaves to be added
+  public: input_errors errors;                   // invalid rows
+
+  // classify every row of the leaves file, rows without family or bases are collected in errors
+  public: void create() {
+    LOG_VERBOSE(cout, "\n\nReading in Leaves and LCAs");
+    leafcount = 0;
+    ADDoption.reserve(rows.size());
+    leaves_array.reserve(rows.size());
+    row.reserve(rows.size());
+    family_id.reserve(rows.size());
+    for(unsigned int i=0; i<rows.size(); i++) {
+
+      const string &token1 = rows[i].field[0], &token2 = rows[i].field[1];
+      const string &token3 = rows[i].field[2], &token4 = rows[i].field[3];
+      LOG_DEBUG(cout, "\n Token 1 "<<token1<<" Token2 "<<token2<<" Token3 "<<token3<<" Token4 "<<token4<<" DONE");
+
       // ERROR
       if(token2 == "") {
-        std::cout<<"\nInvalid Input ! No family or leaves specified for : "<<token1<<" Exiting !\n";
-        exit(1);
+        errors.push_back(make_pair(rows[i].line, "No family or leaves specified for : " + token1));
+        continue;
       }
-      
+
+      // Slots of this leaf, filled in below
+      ADDoption.push_back(CROWN);
+      family_id.push_back(0);
+      leaves_array.push_back(token1);
+      row.push_back(i);
+
       //------- RANDOM ---------
-      else if(token2 == "RANDOM") {
-        cout<<"\nRANDOM option";
+      if(token2 == "RANDOM") {
+        LOG_VERBOSE(cout, "\nRANDOM option");
         ADDoption[leafcount] = CROWN;//anywhere within the tree, so mark it as CROWN
-        taxa = token1;
-        base1 = initial_t.root;
-        base2 = initial_t.root; 
-        initial_lcas_index[leafcount] = INVALID;
-      } 
-      
+      }
+
       //------------ FAMILY ---------------------
       else if(token3 == "" || token3 == "CROWN" || token3 == "STEM") {
-        taxa = token1;
-        familyName = token2;
-        families[taxa] = familyName;
+        family_id[leafcount] = family_index.insert(token2);
         //select ADDoption, default is STEM
         if(token3 == "CROWN") {
-          cout<<"\nFAMILY CROWN option";
+          LOG_VERBOSE(cout, "\nFAMILY CROWN option");
           ADDoption[leafcount] = FAM_CROWN;
         }
         else {
-          cout<<"\nFAMILY STEM option";
+          LOG_VERBOSE(cout, "\nFAMILY STEM option");
           ADDoption[leafcount] = FAM_STEM;
         }
-        initial_lcas_index[leafcount] = INVALID;        
-      }
-      
-      //----------- CROWN -------------------
-      else if (token4 == "CROWN" || token4 == "crown") {
-       
-         taxa = token1;
-         base1 = token2;
-         base2 = token3; 
-         ADDoption[leafcount] = CROWN;
-         
-         // Get the IDs of the current leaf's bases
-         std::map<std::string, int>::iterator index1  = name2id.find(base1);// Note - I use find to check if bases exist
-         std::map<std::string, int>::iterator index2  = name2id.find(base2);
-         
-         //check if the bases exist
-         if( index1 == name2id.end() || index2 == name2id.end()) {
-           cout<<"\nCannot find bases for "<<taxa<<" in initial tree. Bases are "<<base1<<" , "<<base2<<"\n\tExiting !"<<endl;
-           exit(1);
-         }
-         
-         int base1_id = index1->second;
-         int base2_id = index2->second;
-         
-         // Find the MRCA of the ancestors of curr leaf 
-         int root = lca.lca(base1_id, base2_id);
-         
-         // Point the leaf to the index in the lca array 
-         initial_lcas_index[leafcount] = root;
-         
-         // Store the value of lca in the lca array at specified index 
-         initial_lcas[root] = root; //This will be modified later if the new leaf is added to the stem of this family
-         cout<<"\nCROWN";
       }
-      
-      // --------------STEM--------------------
+
+      //----------- CROWN / STEM, the bases are found in every tree -------------------
       else {
-         taxa = token1;
-         base1 = token2;
-         base2 = token3; 
-         ADDoption[leafcount] = STEM;
-         
-         // Get the IDs of the current leaf's bases
-         std::map<std::string, int>::iterator index1  = name2id.find(base1);
-         std::map<std::string, int>::iterator index2  = name2id.find(base2);
-         
-         //check if the bases exist
-         if( index1 == name2id.end() || index2 == name2id.end()) {
-           cout<<"\nCannot find bases for "<<taxa<<" in initial tree. Bases are "<<base1<<" , "<<base2<<"\n\tExiting !"<<endl;
-           exit(1);
-         }
-         
-         int base1_id = index1->second;
-         int base2_id = index2->second;
-         
-         // Find the MRCA of the ancestors of curr leaf 
-         int root = lca.lca(base1_id, base2_id);
-         
-         //Point the leaf to the index in the lca array 
-         initial_lcas_index[leafcount] = root;
-         
-         // Store the value of lca in the lca array at specified index 
-         initial_lcas[root] = root; //This will be modified later if the new leaf is added to the stem of this family
-         cout<<"\nSTEM";
+        const bool crown = token4 == "CROWN" || token4 == "crown";
+        ADDoption[leafcount] = crown ? CROWN : STEM;
+        LOG_VERBOSE(cout, "\n"<<(crown ? "CROWN" : "STEM"));
       }
-      
-      // Store the leaf label 
-      leaves_array[leafcount] = taxa;
-      leaves.push_back(taxa);
-            
+
       leafcount++;
-      
-      // Read the next leaf 
-      getline(ifs2 ,current_leaf);
-      
-    } 
-  } 
-   
-    
-  cout<<"\nNumber of leaves to be added is "<<leafcount;
-  cout<<"\nNumber of replicates is "<<replicates;
-  cout<<"\n";  
-     
-  // CREATE REPLICATES OF NEW  TREE 
-  for(unsigned int k=0; k<replicates; k++) {
-  
-    cout<<"\n\n\tREPLICATE NUMBER "<<k+1;    
-    int nodecount = initial_nodecount;
-    
-    // Create a parent array and leaf index for each replicate 
-    int* parents = new int[MAX_TOTAL_NODES];
-    int* leaf_index  = new int[leafcount]; 
-    int* added_leaf = new int[leafcount]; 
-    
-    int lcas_index[MAX_TOTAL_NODES];
-    int lcas[MAX_TOTAL_NODES];
-      
-    // Copy the initial parent array
-    for(int i=0; i<nodecount; i++) {
-      parents[i] = initial_parents[i];
     }
-    
-    // copy lca array
+
+    // The families every new leaf joins
+    taxon_families.resize(leafcount);
+    newick_name.resize(leafcount);
     for(int i=0; i<leafcount; i++) {
-      if ( ADDoption[i] == STEM || ADDoption[i] == CROWN ) {
-          lcas_index[i] = initial_lcas_index[i];
-          lcas[initial_lcas_index[i]] =  initial_lcas[initial_lcas_index[i]];
-      } 
+      family_index.matches(leaves_array[i], taxon_families[i]);
+      newick_name[i] = aw::idx2name::pool().intern(NS_input::getlegalstring(leaves_array[i]));
+    }
+  }
+
+  // the leaf is placed below the lca of two bases
+  public: inline bool has_bases(const int i) const {
+    return (ADDoption[i] == CROWN || ADDoption[i] == STEM) && rows[row[i]].field[1] != "RANDOM";
+  }
+};
+
+// An input tree and everything its replicates start from, with the leaves to be added
+// resolved against it. Built once, then only read while its replicates are built.
+class InitialTree {
+  public: unsigned int number;           // of the tree in the tree file, from 0
+  public: aw::BinaryTree t;
+  public: aw::idx2name name;
+  public: aw::idx2weight_double weight;
+  public: int leafn;                     // number of leaves
+  public: vector<int> parents;           // parent array for nodes
+  public: vector<double> height;         // height of the nodes above the tips, measured along the path to the first leaf below them
+  public: vector<int> lcas_index;        // node of the lca array every leaf to be added points to
+  public: vector<int> lcas;              // roots of the subtrees to insert in, moved up by STEM insertions
+  public: aw::FamilyIndex family_index;  // clades of the families in this tree
+  public: unsigned int node_capacity;    // number of nodes of a finished replicate, size of the node arrays
+  public: aw::EdgeSampler sampler;       // edge sampler and preorder sequence, copied by every replicate
+  public: aw::DynamicTour tour;
+  public: aw::DynamicLCA dlca;           // only needed if there are families
+  public: aw::NewickLabels labels;       // preformatted names and branch lengths
+  public: util::Stats stats;             // phases of building it
+  public: string log;                    // messages of building it
+
+  // build it from the newick text [p,end), p is moved after the tree
+  // false if the text is no tree, leaves whose bases are not in the tree are added to errors
+  public: bool create(const unsigned int number_, const char *&p, const char *end, const Taxa &taxa,
+                      const unsigned int precision, input_errors &errors) {
+    number = number_;
+    stats.create(phase_names, PHASES, counter_names, COUNTERS);
+    double clock = util::wall_time();
+    if (!aw::text2tree(p, end, t, name, weight)) return false;
+    clock = stats.time(PHASE_PARSE, clock);
+
+    parents.resize(t.node_size());
+    height.resize(t.node_size());
+    vector<bool> height_set(t.node_size(), false);
+
+    // Map name of the leaves to their id
+    boost::unordered_map<std::string, int> name2id;
+    leafn = 0;
+    weight.fill(t.node_size()); // GatorADD gives every edge without a length one of 0 (the root's)
+    const double initialBL = weight.total();
+
+    // Traverse the tree to create parents array and the leaf map
+    const vector<unsigned int> &postorder = t.postorder(); // kept by the tree for the LCA
+    for (unsigned int i=0,iEE=postorder.size(); i<iEE; ++i) {
+      const unsigned int currnode = postorder[i], parent = t.parent(currnode);
+      if(t.is_leaf(currnode)) {
+        name2id[name.get(currnode)] = currnode;
+        leafn++;
+      }
+      parents[currnode] = parent;
+      if(!height_set[currnode]) height[currnode] = 0; // leaf
+      // the first child in postorder is the first one the DFS walks down
+      if(parent != aw::NONODE && !height_set[parent]) {
+        height[parent] = height[currnode] + weight.first(currnode);
+        height_set[parent] = true;
+      }
+    }
+    clock = stats.time(PHASE_PARENTS, clock);
+
+    util::LogBuffer msg;
+    LOG_INFO(msg, "\nThe number of leaves in the initial tree is "<<leafn);
+    LOG_INFO(msg, "\nThe initial total Branch Length is "<<initialBL);
+    LOG_INFO(msg, "\nThe root age is "<<height[t.root]);
+    msg.take(log);
+
+    // Create an lca object to find lcas of nodes.
+    aw::LCA lca;
+    lca.create(t);
+    clock = stats.time(PHASE_LCA, clock);
+
+    // Subtree roots of the leaves to be added
+    lcas_index.assign(taxa.leafcount, INVALID);
+    lcas.assign(t.node_size(), INVALID);
+    vector<int> based;                                  // leaves with bases, their lcas are found together
+    vector<pair<unsigned int, unsigned int> > bases;
+    for(int i=0; i<taxa.leafcount; i++) {
+      //------- RANDOM, the whole tree is the subtree ---------
+      if(taxa.ADDoption[i] == CROWN && !taxa.has_bases(i)) {
+        lcas_index[i] = t.root;
+        lcas[t.root] = t.root;
+      }
+
+      //----------- CROWN / STEM -------------------
+      else if(taxa.has_bases(i)) {
+        const util::LeavesRow &row = taxa.rows[taxa.row[i]];
+
+        // Get the IDs of the current leaf's bases
+        boost::unordered_map<std::string, int>::const_iterator index1 = name2id.find(row.field[1]);
+        boost::unordered_map<std::string, int>::const_iterator index2 = name2id.find(row.field[2]);
+
+        //check if the bases exist
+        if( index1 == name2id.end() || index2 == name2id.end()) {
+          errors.push_back(make_pair(row.line, "Cannot find bases for " + row.field[0] + " in initial tree. Bases are "
+                                               + row.field[1] + " , " + row.field[2]));
+          continue;
+        }
+        based.push_back(i);
+        bases.push_back(make_pair(index1->second, index2->second));
+      }
+    }
+
+    // Find the MRCAs of the bases of all leaves at once
+    vector<unsigned int> roots;
+    lca.lca(bases, roots);
+    for(unsigned int j=0; j<based.size(); j++) {
+      const int root = roots[j];
+
+      // Point the leaf to the index in the lca array
+      lcas_index[based[j]] = root;
+
+      // Store the value of lca in the lca array at specified index
+      lcas[root] = root; //This will be modified later if the new leaf is added to the stem of this family
+    }
+    clock = stats.time(PHASE_LEAVES, clock);
+
+    // Clades of the families in this tree
+    family_index = taxa.family_index;
+    family_index.create(name, lca);
+    clock = stats.time(PHASE_FAMILIES, clock);
+
+    // Every insertion adds an internal node and a leaf
+    node_capacity = t.node_size() + 2 * taxa.leafcount;
+    parents.resize(node_capacity);
+    height.resize(node_capacity);
+    lcas.resize(node_capacity, INVALID);
+
+    sampler.create(weight, node_capacity);
+    tour.create(t, weight, node_capacity);
+    if (family_index.size() != 0) dlca.create(t, node_capacity);
+
+    // Names and branch lengths are formatted once
+    labels.create(t, name, weight, precision);
+    stats.time(PHASE_SETUP, clock);
+    return true;
+  }
+};
+
+// The trees of the tree file. A tree is built by the first thread that needs it; threads
+// waiting for a tree that is being built meanwhile build the next trees nobody has claimed
+// yet, up to lookahead trees ahead. A tree is freed once all its replicates are written.
+class InitialTrees {
+  protected: enum{UNCLAIMED, BUILDING, READY, FREED};
+  protected: const Taxa &taxa;
+  protected: vector<const char*> texts;   // start of the text of every tree and the end of the last one
+  protected: vector<InitialTree*> trees;
+  protected: vector<char> state;
+  protected: unsigned int precision, lookahead;
+  protected: string leaves_file, tree_file; // for the error messages
+  protected: pthread_mutex_t mutex;
+  protected: pthread_cond_t cond_ready;
+
+  // all trees of [begin,end) or only the first one
+  public: InitialTrees(const Taxa &taxa_, const char *begin, const char *end, const bool all,
+                       const unsigned int precision_, const unsigned int lookahead_,
+                       const string &leaves_file_, const string &tree_file_)
+    : taxa(taxa_), precision(precision_), lookahead(lookahead_), leaves_file(leaves_file_), tree_file(tree_file_) {
+    const char *p = begin;
+    texts.push_back(p);
+    if (all) {
+      while (aw::newick_next(p, end) != end) {
+        p = aw::newick_tree_end(p, end);
+        texts.push_back(p);
+      }
+      if (texts.size() == 1) texts.push_back(end); // no tree, reported by get(0)
+    } else texts.push_back(end);
+    trees.assign(texts.size() - 1, NULL);
+    state.assign(trees.size(), UNCLAIMED);
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond_ready, NULL);
+  }
+
+  public: ~InitialTrees() {
+    for (unsigned int i=0; i<trees.size(); i++) delete trees[i];
+    pthread_cond_destroy(&cond_ready);
+    pthread_mutex_destroy(&mutex);
+  }
+
+  public: inline unsigned int size() const { return trees.size(); }
+
+  // newick text of tree i
+  public: inline string text(const unsigned int i) const { return string(texts[i], texts[i+1]); }
+
+  // tree i, built if nobody has done it yet; safe to call from any thread
+  public: InitialTree &get(const unsigned int i) {
+    pthread_mutex_lock(&mutex);
+    while (state[i] != READY) {
+      unsigned int next = i;
+      while (next < size() && next <= i + lookahead && state[next] != UNCLAIMED) ++next;
+      if (next < size() && next <= i + lookahead) {
+        state[next] = BUILDING;
+        pthread_mutex_unlock(&mutex);
+        InitialTree *tree = build(next);
+        pthread_mutex_lock(&mutex);
+        trees[next] = tree;
+        state[next] = READY;
+        pthread_cond_broadcast(&cond_ready);
+      } else pthread_cond_wait(&cond_ready, &mutex);
+    }
+    InitialTree &tree = *trees[i];
+    pthread_mutex_unlock(&mutex);
+    return tree;
+  }
+
+  // tree i is not needed anymore
+  public: void release(const unsigned int i) {
+    pthread_mutex_lock(&mutex);
+    delete trees[i];
+    trees[i] = NULL;
+    state[i] = FREED;
+    pthread_mutex_unlock(&mutex);
+  }
+
+  // exits on errors in the tree or in the leaves file
+  protected: InitialTree *build(const unsigned int i) {
+    InitialTree *tree = new InitialTree;
+    input_errors errors = taxa.errors;
+    const char *p = texts[i];
+    if (!tree->create(i, p, texts[i+1], taxa, precision, errors)) {
+      if (size() == 1) cout<<"Unable to read tree from file! Exiting!";
+      else cout<<"Unable to read tree "<<i+1<<" from file! Exiting!";
+      exit(1);
+    }
+    ostringstream where;
+    where<<leaves_file;
+    if (size() > 1) where<<" for tree "<<i+1<<" of "<<tree_file;
+    exit_on_errors(errors, where.str());
+    return tree;
+  }
+};
+
+// Builds the replicates, the replicates of a tree are numbers [t * replicates, (t+1) * replicates)
+// of the job. Everything read in by main() is shared read-only between the worker threads,
+// the state of a replicate lives in the workspace of the thread building it and only holds
+// what differs from its initial tree.
+class ReplicateBuilder {
+  public: struct result_type {
+    std::string tree; // newick string of the replicate
+    std::vector<delta::Graft> grafts; // or its grafts for the binary output
+    std::string log;  // messages produced while building it
+    util::Stats stats;
+    double seconds;   // wall time of building it
+  };
+
+  public: ReplicateBuilder(const Taxa &taxa_, InitialTrees &trees_, const unsigned int replicates_,
+                           const uint64_t seed_, const unsigned int first_, const unsigned int threads,
+                           const bool binary_, util::AsyncWriter &out_,
+                           const bool replicate_stats_, const double progress_interval)
+    : taxa(taxa_), trees(trees_), replicates(replicates_),
+      ADDoption(taxa_.ADDoption), leaves_array(taxa_.leaves_array), leafcount(taxa_.leafcount),
+      family_id(taxa_.family_id), taxon_families(taxa_.taxon_families),
+      seed(seed_), first(first_), binary(binary_), out(out_), workspaces(threads),
+      replicate_stats(replicate_stats_) {
+    stats_.create(phase_names, PHASES, counter_names, COUNTERS);
+    progress.create(cerr, progress_interval, trees.size() * replicates, "replicates");
+  }
+
+  // build replicate i
+  public: void run(const unsigned int i, result_type &r, const unsigned int thread) {
+    const double start = util::wall_time();
+    workspace &ws = workspaces[thread];
+    r.tree.clear(); // keeps the buffers of the last replicate in this slot
+    r.grafts.clear();
+    if (r.stats.seconds.empty()) r.stats.create(phase_names, PHASES, counter_names, COUNTERS);
+    else r.stats.clear();
+    build(trees.get(i / replicates), first + i % replicates, ws, r, ws.log);
+    ws.log.take(r.log);
+    r.seconds = util::wall_time() - start;
+  }
+
+  // write replicate i to the output file (called in replicate order)
+  public: void write(const unsigned int i, result_type &r) {
+    double clock = util::wall_time();
+    const unsigned int tree = i / replicates, k = i % replicates;
+    if (k == 0) { // messages and phases of building the tree
+      InitialTree &initial = trees.get(tree);
+      if (!initial.log.empty()) cout<<initial.log;
+      stats_.add(initial.stats);
+    }
+    if (!r.log.empty()) cout<<r.log;
+    if (binary) {
+      record.clear();
+      delta::write_replicate(record, first + k + 1, r.grafts);
+      out.write(record);
+    } else {
+      out.write(r.tree);
+      out.write('\n');
+    }
+    if (k + 1 == replicates) trees.release(tree);
+    r.stats.time(PHASE_WRITE, clock);
+    r.stats.count(COUNT_REPLICATES);
+    stats_.add(r.stats);
+    if (replicate_stats) {
+      replicate_json << (i == 0 ? "" : ",\n") << "  {";
+      if (trees.size() > 1) replicate_json << "\"tree\": " << tree + 1 << ", ";
+      replicate_json << "\"replicate\": " << first + k + 1 << ", \"seconds\": " << r.seconds << ", ";
+      r.stats.json(replicate_json);
+      replicate_json << '}';
+    }
+    progress.update(i + 1);
+  }
+
+  // phases and counters of all replicates written so far
+  public: const util::Stats &stats() const { return stats_; }
+
+  // the entries of all replicates written so far, separated by ",\n"
+  public: string replicates_json() const { return replicate_json.str(); }
+
+  // state of a replicate; every thread keeps one for all its replicates. it is a full copy
+  // of the initial state only for the first one of a tree, later ones just undo the changes of the last
+  protected: struct workspace {
+    workspace() : tree(UINT_MAX) {}
+    unsigned int tree; // number of the tree it holds, UINT_MAX for none
+    aw::TreeOverlay<aw::BinaryTree, aw::idx2weight_double> t; // tree, labels & weights
+    aw::EdgeSampler sampler;
+    aw::DynamicTour tour;
+    aw::DynamicLCA dlca;
+    vector<int> parents;
+    vector<double> height;
+    vector<int> lcas;
+    vector<int> leaf_index;
+    vector<int> added_leaf;
+    vector<unsigned int> family_roots;
+    util::TouchedSet touched; // nodes changed in parents, height and lcas
+    util::LogBuffer log;      // messages of the replicate being built
+  };
+
+  protected: void build(InitialTree &initial, const unsigned int k, workspace &ws, result_type &r, util::LogBuffer &log);
+
+  protected: const Taxa &taxa;
+  protected: InitialTrees &trees;                          // the bases of the replicates, only read
+  protected: const unsigned int replicates;                // per tree
+  protected: const vector<int> &ADDoption;
+  protected: const vector<string> &leaves_array;
+  protected: const int leafcount;
+  protected: const vector<unsigned int> &family_id;        // family of every leaf to be added
+  protected: const vector<vector<unsigned int> > &taxon_families; // families whose name is part of the leaf name
+  protected: const uint64_t seed;
+  protected: const unsigned int first;
+  protected: const bool binary;
+  protected: util::AsyncWriter &out;
+  protected: string record; // binary record being written
+  protected: vector<workspace> workspaces;
+  protected: util::Stats stats_;
+  protected: const bool replicate_stats; // collect the entries of the replicates for --stats
+  protected: ostringstream replicate_json;
+  protected: util::Progress progress;
+};
+
+int main(int argc, char* argv[]) {
+
+  if(argc<5){
+    cout<<"Incorrect Arguments ! Exiting! \n\t usage - ./exec tree_file leaves_file replicates opfile [--threads N] [--seed S] [--first K] [--precision P] [--binary] [--all-trees] [--verbosity V] [--stats FILE] [--progress SECONDS]\n";
+    exit(1);
+  }
+
+  // Read in options following the positional arguments
+  unsigned int threads = 1;
+  uint64_t seed = time(NULL); // seed of Rand number generator
+  unsigned int first = 1;
+  unsigned int precision = 6;
+  bool binary = false;
+  bool all_trees = false;
+  string stats_file;
+  double progress_interval = 0;
+  {
+    Argument a; a.add(argc-4, argv+4);
+    if (a.existArgVal2("-j", "--threads", threads) && threads == 0) MSG_exit("number of threads has to be at least 1");
+    a.existArgVal2("-s", "--seed", seed);
+    if (a.existArgVal2("-f", "--first", first) && first == 0) MSG_exit("replicates are numbered from 1");
+    if (a.existArgVal2("-p", "--precision", precision) && (precision == 0 || precision > 17)) MSG_exit("precision has to be between 1 and 17");
+    binary = a.existArg2("-b", "--binary");
+    all_trees = a.existArg2("-a", "--all-trees");
+    if (a.existArgVal2("-v", "--verbosity", util::log_level()) && util::log_level() > util::LOG_LEVEL_DEBUG) MSG_exit("verbosity has to be between 0 and 3");
+    a.existArgVal("--stats", stats_file);
+    if (a.existArgVal("--progress", progress_interval) && progress_interval <= 0) MSG_exit("progress interval has to be positive");
+    a.unusedArgsError();
+    if (binary && all_trees) MSG_exit("the binary output holds a single initial tree, it cannot be used with --all-trees");
+  }
+
+  // Phases of the setup, the builder collects the ones of the trees and replicates
+  util::Stats stats;
+  stats.create(phase_names, PHASES, counter_names, COUNTERS);
+  const double start = util::wall_time();
+  double clock = start;
+  ofstream stats_os;
+  if (!stats_file.empty()) {
+    stats_os.open(stats_file.c_str());
+    if (!stats_os.good()) MSG_exit("unable to open stats file " << stats_file);
+  }
+
+  // Read in command line arguments
+  char* treefile = argv[1];
+  char* leaves_file = argv[2];
+  unsigned int   replicates = atoi(argv[3]);
+  char* opfile = argv[4];
+
+  // The tree file is mapped into memory, the trees are parsed when they are needed
+  util::MappedFile tree_file;
+  if(!tree_file.open(treefile)) {
+    cout<<"Unable to open tree file! Exiting!\n";
+    exit(1);
+  }
+
+  // Read in leaves to be added from file
+  Taxa taxa;
+  if(!util::read_leaves_file(leaves_file, taxa.rows)) {
+    cout<<"\nUnable to open leaves to be added file !";
+    exit(1);
+  }
+  taxa.create();
+  clock = stats.time(PHASE_LEAVES, clock);
+
+  // The first tree is built right away, so errors in the input are reported before anything is written
+  InitialTrees trees(taxa, tree_file.begin(), tree_file.end(), all_trees, precision, threads, leaves_file, treefile);
+  if (replicates != 0 && trees.size() > UINT_MAX / replicates) MSG_exit("too many trees and replicates");
+  InitialTree &initial = trees.get(0);
+  cout<<initial.log;
+  initial.log.clear();
+  stats.add(initial.stats);
+  initial.stats.clear();
+  const unsigned int nodes = initial.t.node_size(), leafn = initial.leafn;
+
+  // Open output file
+  ofstream ofs(opfile);
+  if(!ofs.good()) {
+    cout << "unable to open output file!";
+    exit(1);
+  }
+
+  LOG_INFO(cout, "\nNumber of leaves to be added is "<<taxa.leafcount);
+  if (all_trees) LOG_INFO(cout, "\nNumber of trees is "<<trees.size());
+  LOG_INFO(cout, "\nNumber of replicates is "<<replicates);
+  LOG_INFO(cout, "\nNumber of threads is "<<threads);
+  LOG_INFO(cout, "\nSeed is "<<seed);
+  LOG_INFO(cout, "\n");
+
+  // The output is written in the background
+  util::AsyncWriter out(ofs);
+  if (binary) {
+    string header;
+    delta::write_header(header, precision, trees.text(0), taxa.leaves_array);
+    out.write(header);
+  }
+  clock = stats.time(PHASE_SETUP, clock);
+
+  // CREATE REPLICATES OF NEW TREES, the ones of the first tree, then the ones of the second, ...
+  ReplicateBuilder builder(taxa, trees, replicates, seed, first - 1, threads, binary, out,
+                           !stats_file.empty(), progress_interval);
+  util::ordered_parallel_for(builder, trees.size() * replicates, threads);
+  if (!out.close()) {
+    cout << "unable to write output file!";
+    exit(1);
+  }
+  const double replicates_seconds = util::wall_time() - clock;
+
+  // Report of the phases
+  if (!stats_file.empty()) {
+    stats.add(builder.stats());
+    stats_os.precision(9);
+    stats_os << "{\"program\": \"GatorADD\", \"build\": ";
+    util::json_string(stats_os, builddate);
+    stats_os << ",\n \"input\": {\"tree_file\": ";
+    util::json_string(stats_os, treefile);
+    stats_os << ", \"leaves_file\": ";
+    util::json_string(stats_os, leaves_file);
+    stats_os << ", \"trees\": " << trees.size() << ", \"nodes\": " << nodes << ", \"leaves\": " << leafn << ", \"taxa\": " << taxa.leafcount
+             << ", \"replicates\": " << replicates << ", \"first\": " << first << ", \"threads\": " << threads
+             << ", \"seed\": " << seed << "},\n \"seconds\": " << util::wall_time() - start
+             << ",\n \"replicates_seconds\": " << replicates_seconds << ",\n \"peak_rss_kb\": " << util::peak_rss_kb() << ",\n ";
+    stats.json(stats_os);
+    stats_os << ",\n \"replicates\": [\n" << builder.replicates_json() << "\n ]}\n";
+    if (!stats_os.good()) MSG_exit("unable to write stats file " << stats_file);
+  }
+
+  LOG_INFO(cout, "\n");
+  return 0;
+
+
+}
+
+// Build replicate k of an initial tree: insert all new leaves into a copy of it
+// and append it to r. Replicate k of tree t draws from stream t * 2^32 + k of the
+// seed, so it comes out the same no matter in which order or on which thread it
+// is built, and the replicates of the first tree are the ones of a single tree.
+void ReplicateBuilder::build(InitialTree &initial, const unsigned int k, workspace &ws, result_type &r, util::LogBuffer &log) {
+
+    // random number stream of this replicate
+    util::RandomStream rng(seed, ((uint64_t)initial.number << 32) | k);
+    util::Stats &st = r.stats;
+    double clock = util::wall_time();
+
+    if (trees.size() > 1) {
+      LOG_INFO(log, "\n\n\tTREE NUMBER "<<initial.number+1<<" REPLICATE NUMBER "<<k+1);
+    } else {
+      LOG_INFO(log, "\n\n\tREPLICATE NUMBER "<<k+1);
     }
-  
+
+    // Bring the workspace to the initial state
+    const aw::FamilyIndex &family_index = initial.family_index;
+    const vector<int> &initial_lcas_index = initial.lcas_index;
+    const bool track_families = family_index.size() != 0;
+    if (ws.tree != initial.number) { // first replicate of the tree on this thread
+      ws.t.create(initial.t, initial.weight, initial.node_capacity);
+      ws.sampler = initial.sampler;
+      ws.tour = initial.tour;
+      if (track_families) ws.dlca = initial.dlca;
+      ws.parents = initial.parents;
+      ws.height = initial.height;
+      ws.lcas = initial.lcas;
+      ws.touched.create(initial.node_capacity);
+      ws.tree = initial.number;
+    } else { // undo the last replicate
+      ws.t.reset();
+      ws.sampler.restore(initial.sampler);
+      ws.tour.restore(initial.tour);
+      if (track_families) ws.dlca.restore(initial.dlca);
+      for (unsigned int i=0; i<ws.touched.size(); i++) {
+        const unsigned int v = ws.touched[i];
+        ws.parents[v] = initial.parents[v];
+        ws.height[v] = initial.height[v];
+        ws.lcas[v] = initial.lcas[v];
+      }
+      ws.touched.clear();
+    }
+    ws.leaf_index.resize(leafcount);
+    ws.added_leaf.resize(leafcount);
+    ws.family_roots = family_index.roots();
+    clock = st.time(PHASE_RESET, clock);
+
+    vector<int> &parents = ws.parents;
+    vector<double> &height = ws.height;
+    vector<int> &leaf_index = ws.leaf_index;
+    vector<int> &added_leaf = ws.added_leaf;
+    vector<int> &lcas = ws.lcas;
+    util::TouchedSet &touched = ws.touched;
+
     // Declare tree, labels & weights
-    aw::Tree t = initial_t;
-    aw::idx2name t_name = initial_t_name;
-    aw::idx2weight_double t_weight = initial_t_weight;
-          
+    aw::TreeOverlay<aw::BinaryTree, aw::idx2weight_double> &t = ws.t;
+    aw::EdgeSampler &sampler = ws.sampler;
+    aw::DynamicTour &tour = ws.tour;
+
+    // Clade roots of the families
+    vector<unsigned int> &family_roots = ws.family_roots;
+    aw::DynamicLCA &dlca = ws.dlca;
+
     // Number of leaves left to be added
     int leaves_remaining = leafcount;
-      
+
     // Initialise all leaves as not added and copy leaf indices
     for(int i=0; i<leafcount; i++) {
       leaf_index[i] = i;
       added_leaf[i] = NOT_ADDED;
     }
-      
-    // Add Leaves to initial tree 
+
+    // Add Leaves to initial tree
     for(int j=0; j<leafcount; j++) {
-    
+
       int random_leaf_index;
       int random;
-            
+
       // pick a random LEAF to add to the TREE
       do {
-	random = rand() % leaves_remaining;
-	random_leaf_index = leaf_index[random];
+        random = rng.uniform(leaves_remaining);
+        random_leaf_index = leaf_index[random];
       } while(added_leaf[random_leaf_index]==ADDED);
-   
+
       added_leaf[random_leaf_index] = ADDED;//mark leaf as added
-     
+
       // shift leaves by 1
       leaf_index[random] = leaf_index[leaves_remaining-1];
       leaves_remaining--;
-      string newleaf = leaves_array[random_leaf_index];
-      cout<<"\n\n  ADDING "<<newleaf;   
-      
-      // root of subtree and parent to insert new taxa
+      const string &newleaf = leaves_array[random_leaf_index];
+      LOG_DEBUG(log, "\n\n  ADDING "<<newleaf);
+
+      // root of subtree to insert new taxa
       int subtree_root;
-      unsigned int subtree_root_parent;
-      
+
       //--------STEM-------
       if( ADDoption[random_leaf_index] == STEM ) {
-        cout<<"\nSTEM ADD";         
-        int lca_index = lcas_index[random_leaf_index];
+        LOG_DEBUG(log, "\nSTEM ADD");
+        int lca_index = initial_lcas_index[random_leaf_index];
         subtree_root = lcas[lca_index];
-        subtree_root_parent = parents[subtree_root];
-        cout<<"\nTHE STEM CASE ROOT IS "<<subtree_root;
+        LOG_DEBUG(log, "\nTHE STEM CASE ROOT IS "<<subtree_root);
       }
-      
+
       //--------CROWN--------
       else if ( ADDoption[random_leaf_index] == CROWN ) {
-        cout<<"\nCROWN ADD";
-        int lca_index = lcas_index[random_leaf_index];
+        LOG_DEBUG(log, "\nCROWN ADD");
+        int lca_index = initial_lcas_index[random_leaf_index];
         subtree_root = lcas[lca_index];
-        subtree_root_parent = parents[subtree_root];
-        cout<<"\nTHE CROWN CASE ROOT IS "<<subtree_root;
+        LOG_DEBUG(log, "\nTHE CROWN CASE ROOT IS "<<subtree_root);
       }
-      
+
       //--------FAMILY--------
-      else if ( ADDoption[random_leaf_index] == FAM_CROWN || ADDoption[random_leaf_index] == FAM_STEM ) {
-        
-        cout<<"\n\tFAMILY ADD : ";
-        string family = families[newleaf];
-        cout<<"newleaf is "<<newleaf<<" family is "<<family;
-        int flag = 0, left, right;
-        
-        //LETS FIND LCA HERE      
-        TREE_INORDER2(k,t) {
-          //cout<<t_name[k.idx];
-          string leaf = t_name[k.idx];
-          size_t found = leaf.find(family);
-          if (found !=string::npos) {
-            //cout<<"\nFAMILY MATCH taxon is "<<leaf<<" family is "<<family;            
-            if(flag == 0) {
-              left = k.idx;
-              flag = 1;
-            }
-            
-            else {
-              right = k.idx;
-            }
-            
-          }
-        }
-        
-        if(flag == 0) {
-          cout<<"\nFamily prefix "<<family<<" not found ! Exiting! \n";
-          exit(1);
+      else {
+
+        LOG_DEBUG(log, "\n\tFAMILY ADD : ");
+        const unsigned int f = family_id[random_leaf_index];
+        LOG_DEBUG(log, "newleaf is "<<newleaf<<" family is "<<family_index.name(f));
+
+        if((unsigned int)(subtree_root = family_roots[f]) == aw::NONODE) {
+          MSG_exit("\nFamily prefix "<<family_index.name(f)<<" not found ! Exiting! ");
         }
-        
-        // Find the MRCA of the ancestors of curr leaf - Create an lca object to find lcas of nodes.
-        aw::LCA lca;
-        lca.create(t);
-        subtree_root = lca.lca(left, right);
-        subtree_root_parent = parents[subtree_root];
-        cout<<"\n The left base is "<<t_name[left]<<" The right base is "<<t_name[right];
-        //cout<<"\n THE FAMILY CASE ROOT IS "<<subtree_root;
-        
-      }
-      
-      // Calculate the branch length of the curr family subtree 
-      double subtree_bl = 0;
-      
-      // Store branch lengths of current subtree
-      double* bl_array = new double[MAX_TOTAL_NODES];
-      int subtree_nodecount = 1;
-      bl_array[0] = 0; // Add the branch lengths from first element
-      
-      // Traverse the subtree of current family 
-      for (aw::Tree::iterator_postorder v=t.begin_postorder(subtree_root,subtree_root_parent),vEE=t.end_postorder(); v!=vEE; ++v) {
-	unsigned int current_node = v.idx;
-	//cout<<"\nNode "<<current_node<<" Branch Length: "<<t_weight[current_node][0];
-	subtree_bl += t_weight[current_node][0];
-	translate_index[subtree_nodecount] = current_node;
-	bl_array[subtree_nodecount++] = subtree_bl;
+        LOG_DEBUG(log, "\n THE FAMILY CASE ROOT IS "<<subtree_root);
+
       }
-      //cout<<"\n TOTAL SUBTREE BL "<<subtree_bl;
-      
+      clock = st.time(PHASE_PICK, clock);
+
       // Select a random branch length and edge
-      int untranslated_node;
       int selected_edge; //edge where to add the random leaf
       double randomblength;
-      do {
-      
-	randomblength = (double)rand() * (double)subtree_bl / (double)RAND_MAX; 
-	//cout<<"\nRandomblength is "<<randomblength;
-	untranslated_node = binarysearch( bl_array, subtree_nodecount, randomblength);
-	if ( untranslated_node < 1 || untranslated_node > subtree_nodecount ) {
-	  cout<<"\nERROR 43x! Exiting !";
-	  exit(1);
-	}
-	//cout<<"\nEdge : "<<untranslated_node<<" Translated: "<<translate_index[untranslated_node]; 
-	selected_edge = translate_index[untranslated_node];
-	
-	//Check for root of tree
-	if(selected_edge == (signed)t.root) { //STEM option
-	  cout<<"\nSelected Root ! continuing !";
-	  continue;
-	}
-	
-	//CROWN option check
-	else if ( (selected_edge == subtree_root) && ( ADDoption[random_leaf_index] == CROWN || ADDoption[random_leaf_index] == FAM_CROWN) ) { 
-	  cout<<"\nSelected subtree root ( not allowed for CROWN ) ! continuing !";
-	  continue;
-	}
-	
-	break;
-	
-      } while(1);
-            
-      //cout<<"\nUntranslated Edge "<<untranslated_node<<"max nodes "<<MAX_TOTAL_NODES;
-      
-      // Obtain the individual lengths by subtracting the cumulative lengths
-      double original_length;
-      //if( untranslated_node == 0 ) {        // First link in the chain
-        //original_length = bl_array[untranslated_node];
-        //randomblength = randomblength - bl_array[untranslated_node];
-      //}
-      //else {        
-      {
-        original_length = bl_array[untranslated_node] - bl_array[untranslated_node-1];
-        randomblength = randomblength - bl_array[untranslated_node-1];
+      const bool whole_tree = subtree_root == (signed)t.root;
+
+      // The edge above the tree root and, for CROWN, the stem of the subtree are not allowed;
+      // they are the first edge of the subtree, so they are left out of the draw instead of
+      // drawing again when they come up, which gives the same distribution
+      const bool exclude_stem = whole_tree || ADDoption[random_leaf_index] == CROWN || ADDoption[random_leaf_index] == FAM_CROWN;
+
+      // Branch length of the curr subtree, the whole tree is faster with the edge sampler
+      double subtree_bl = whole_tree ? sampler.total() : tour.clade_weight(subtree_root);
+      if (exclude_stem) subtree_bl -= sampler.weight(subtree_root);
+      if( subtree_bl > 0 ) {
+        randomblength = rng.uniform() * subtree_bl;
+        if( whole_tree )
+          selected_edge = sampler.sample_excluding(randomblength, randomblength, subtree_root);
+        else if( exclude_stem )
+          selected_edge = tour.sample_below(subtree_root, randomblength, randomblength);
+        else
+          selected_edge = tour.sample(subtree_root, randomblength, randomblength);
       }
-      double reduce_length =   original_length - randomblength;
-      
-      // Change length of branch where inserted 
-      t_weight[selected_edge][0] = randomblength;
-            
-      // Insert new internal node to attach new leaf 
-      unsigned int i_n = t.new_node();
-      t_weight[i_n][0] = reduce_length;
-  
-      // Insert the new leaf 
-      unsigned int l_n = t.new_node(); 
-      t_name[l_n] = newleaf;
-      parents[l_n] = i_n;
-      
-      // Change LCA ARRAY if selected edge is the root i.e STEM CASE
-      if( selected_edge == subtree_root && ( ADDoption[random_leaf_index] == STEM || ADDoption[random_leaf_index] == FAM_STEM) ) {
-        lcas[subtree_root] = i_n;
+      else { // no branch lengths, all allowed edges are equally likely
+        const unsigned int skip = exclude_stem ? 1 : 0;
+        const unsigned int size = tour.clade_size(subtree_root);
+        if (size <= skip) MSG_exit("\nNo edge to add "<<newleaf<<" to, the subtree is a single leaf ! Exiting! ");
+        selected_edge = tour.sample_uniform(subtree_root, skip + rng.uniform(size - skip));
+        randomblength = 0;
       }
-      
-      // Remove the edge b/w selected node and parent 
+      clock = st.time(PHASE_SAMPLE, clock);
+
+      double original_length = sampler.weight(selected_edge);
+      double reduce_length =   original_length - randomblength;
       unsigned int current_parent = parents[selected_edge];// parent of selected edge
-      t.remove_edge(current_parent, selected_edge);
-          
-      // Add an edge b/w new internal and selected node 
-      t.add_edge(i_n, selected_edge);
+
+      // Branch-length of new leaf for ultra-metric tree, the new internal node sits
+      // randomblength above the selected node; the heights of all other nodes stay
+      double leafLength = height[selected_edge] + randomblength;
+
+      // Split the selected edge with a new internal node and attach the new leaf to it
+      unsigned int i_n = t.graft(selected_edge, current_parent, randomblength, leafLength, *taxa.newick_name[random_leaf_index]);
+      unsigned int l_n = i_n + 1;
+      if (binary) {
+        delta::Graft g = {(uint32_t)random_leaf_index, (uint32_t)selected_edge, randomblength, leafLength};
+        r.grafts.push_back(g);
+      }
+
+      // Update parents and heights
+      touched.touch(selected_edge);
+      touched.touch(i_n);
+      touched.touch(l_n);
       parents[selected_edge] = i_n;
-          
-      // Assign parent of new internal to old parent of selected 
-      t.add_edge(i_n, current_parent);
       parents[i_n] = current_parent;
-            
-      double leafLength = 0;
-      unsigned int parent = parents[i_n];
-      
-      // Find branch-length of new leaf for ultra-metric tree, DFS from selected edge to leaf
-      for (aw::Tree::iterator_dfs v=t.begin_dfs(i_n, parent),vEE=t.end_dfs(); v!=vEE; ++v) {
-	unsigned int node = v.idx;
-	if (node == i_n)//don't add current nodes length 
-	  continue;
-	leafLength += t_weight[node][0];
-	if(t.is_leaf(node)){
-	  break;	  
-	}	  
-      }        
-      
-      // Add edge b/w new leaf and new internal 
-      t.add_edge(i_n, l_n);
-            
-      // Weight of new leaf node
-      t_weight[l_n][0] = leafLength;       
-     
-      delete [] bl_array; 
-      
-      //ostringstream os;
-      //aw::tree2newick(os, t, t_name, t_weight);
-      //cout<<"\n"<<os.str()<<endl;
-         
+      parents[l_n] = i_n;
+      height[i_n] = leafLength;
+      height[l_n] = 0;
+
+      // Change LCA ARRAY if selected edge is the root i.e STEM CASE, family clades are updated below
+      if( selected_edge == subtree_root && ADDoption[random_leaf_index] == STEM ) {
+        lcas[initial_lcas_index[random_leaf_index]] = i_n;
+        touched.touch(initial_lcas_index[random_leaf_index]);
+      }
+
+      // Edge lengths for sampling
+      sampler.set(selected_edge, randomblength);
+      tour.set_weight(selected_edge, randomblength);
+      sampler.set(i_n, reduce_length);
+      tour.graft(selected_edge, i_n, l_n);
+      tour.set_weight(i_n, reduce_length);
+      sampler.set(l_n, leafLength);
+      tour.set_weight(l_n, leafLength);
+      st.count(COUNT_INSERTIONS);
+      clock = st.time(PHASE_GRAFT, clock);
+
+      // The new leaf joins the clades of the families in its name, the clade root
+      // moves up to the MRCA of the old root and the new leaf
+      if (track_families) {
+        dlca.graft(selected_edge, i_n, l_n);
+        BOOST_FOREACH(const unsigned int &fam, taxon_families[random_leaf_index]) {
+          family_roots[fam] = dlca.lca(family_roots[fam], l_n);
+        }
+        clock = st.time(PHASE_FAMILY_ROOTS, clock);
+      }
     }
-    // Calculate new branch length   
-    double bl_temp =0;
-    TREE_POSTORDER2(k,t) {
-	unsigned int currnode = k.idx;    
-	bl_temp += t_weight[currnode][0]; 
-	//cout<<"\nbranch length "<<t_weight[currnode][0];
-    }   
-    cout<<"\nThe new total branch length is: "<<bl_temp;
-        
-    // Write the tree to file 
-    aw::tree2newick(ofs, t, t_name, t_weight);
-    ofs<<endl;   
-    
-    delete[] parents;
-    delete[] leaf_index;
-    delete[] added_leaf;
-  }
- 
-  delete [] initial_parents; 
-  delete [] translate_index;   
-  cout<<"\n";
-  return 0;
-  
-  
-}  
-
-// Use Binary search to find the branch where the random value fits in
-// BLs is the array of branch lengths
-int binarysearch(double *BLs, int size, double key) {
-
-  int first = 0;
-  int last = size-1, mid;
-  
-  // Only one element
-  if(size == 1) {
-   return 0;
-  }
-  
-  while (first <= last) {
-  
-    mid = (first + last) / 2;  // compute mid point.
-    //cout<<"\n first = "<<first<<" last = "<<last<<" mid = "<<mid;     
-    if ( key > BLs[mid+1] ) 
-      first = mid + 1;  // repeat search in top half.
-    else if ( key < BLs[mid] ) 
-      last = mid - 1; // repeat search in bottom half.
-    else {
-      //cout<<"RETURNING "<<mid+1<<" key "<<key<<" BLS mid "<<BLs[mid]<<" BLS mid+1 "<<BLs[mid+1]<<" size "<<size;
-      return mid+1; // found it. return position 
+    // New branch length, the edge sampler keeps the total
+    LOG_INFO(log, "\nThe new total branch length is: "<<sampler.total());
+    LOG_INFO(log, "\nThe root age is: "<<height[t.root]);
+
+    // Write the tree
+    if (!binary) {
+      t.newick(r.tree, initial.labels);
+      st.time(PHASE_SERIALIZE, clock);
     }
-          
-  }
-  
-  cout<<"\n\tBS Error ! Exiting ! first = "<<first<<" last = "<<last<<" mid = "<<mid<<" key = "<<key<<" BLS 0 "<<BLs[0]<<" DONE ";
-  exit(1);
-  
+
 }
@@ -0,0 +1,94 @@
+/*
+ * Read-only view of a whole file, memory mapped when possible.
+ * Author - Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace util {
+
+// the bytes of a file; regular files are mapped, anything else (pipes, /dev/stdin) is read
+// into a buffer. not copyable, the bytes stay valid until close() or destruction
+class MappedFile {
+    protected: const char *data_;
+    protected: size_t size_;
+    protected: void *map;
+    protected: std::vector<char> buffer;
+
+    protected: MappedFile(const MappedFile &);
+    protected: MappedFile& operator=(const MappedFile &);
+
+    public: MappedFile() : data_(NULL), size_(0), map(NULL) {}
+    public: ~MappedFile() { close(); }
+
+    // false if the file cannot be opened or read
+    public: bool open(const char *path) {
+        close();
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+            void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                #ifdef MADV_SEQUENTIAL
+                madvise(m, st.st_size, MADV_SEQUENTIAL);
+                #endif
+                map = m;
+                data_ = static_cast<const char*>(m);
+                size_ = st.st_size;
+                ::close(fd);
+                return true;
+            }
+        }
+        // read it
+        char chunk[65536];
+        for (;;) {
+            const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n < 0) {
+                ::close(fd);
+                buffer.clear();
+                return false;
+            }
+            if (n == 0) break;
+            buffer.insert(buffer.end(), chunk, chunk + n);
+        }
+        ::close(fd);
+        data_ = buffer.empty() ? NULL : &buffer[0];
+        size_ = buffer.size();
+        return true;
+    }
+
+    public: void close() {
+        if (map != NULL) munmap(map, size_);
+        map = NULL;
+        buffer.clear();
+        data_ = NULL;
+        size_ = 0;
+    }
+
+    public: inline const char *data() const { return data_; }
+    public: inline size_t size() const { return size_; }
+    public: inline const char *begin() const { return data_; }
+    public: inline const char *end() const { return data_ + size_; }
+};
+
+} // end namespace
+
+#endif
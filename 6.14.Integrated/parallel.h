@@ -0,0 +1,133 @@
+/*
+ * Worker pool that runs independent jobs concurrently but hands their results
+ * back strictly in job order.
+ * Author - Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "common.h"
+#include <vector>
+#include <pthread.h>
+
+namespace util {
+
+// runs job.run(i, result, thread) for every i in [0,n) on a pool of threads
+// and passes the results to job.write(i, result) in increasing order of i
+// from the calling thread. at most 'window' results are buffered at a time.
+// JOB has to provide
+//   typedef ... result_type;
+//   void run(const unsigned int i, result_type &r, const unsigned int thread);  // called concurrently
+//   void write(const unsigned int i, result_type &r);                           // called in order
+template<class JOB>
+class OrderedParallelFor {
+    protected: typedef typename JOB::result_type result_type;
+    protected: JOB &job;
+    protected: unsigned int n, threads, window;
+    protected: std::vector<result_type> results; // ring buffer of results, slot = i % window
+    protected: std::vector<char> ready;          // true if the slot holds a finished result
+    protected: unsigned int next;                // next job to hand out
+    protected: unsigned int written;             // number of jobs written so far
+    protected: pthread_mutex_t mutex;
+    protected: pthread_cond_t cond_ready, cond_space;
+
+    protected: struct worker_arg {
+        OrderedParallelFor *pool;
+        unsigned int thread;
+    };
+
+    public: OrderedParallelFor(JOB &job_, const unsigned int n_, const unsigned int threads_, const unsigned int window_ = 0) : job(job_), n(n_) {
+        threads = threads_ == 0 ? 1 : threads_;
+        window = window_ == 0 ? 4 * threads : window_;
+        if (window < threads) window = threads;
+        next = written = 0;
+    }
+
+    // execute all jobs and return after the last one has been written
+    public: void run() {
+        if (threads == 1) { // no need for a pool
+            results.resize(1);
+            for (unsigned int i=0; i<n; ++i) {
+                job.run(i, results[0], 0);
+                job.write(i, results[0]);
+            }
+            return;
+        }
+        results.resize(window);
+        ready.assign(window, 0);
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond_ready, NULL);
+        pthread_cond_init(&cond_space, NULL);
+        std::vector<pthread_t> tid(threads);
+        std::vector<worker_arg> args(threads);
+        for (unsigned int t=0; t<threads; ++t) {
+            args[t].pool = this;
+            args[t].thread = t;
+            if (pthread_create(&tid[t], NULL, worker_main, &args[t]) != 0) ERROR_exit("cannot create worker thread");
+        }
+        // the calling thread is the writer
+        for (unsigned int i=0; i<n; ++i) {
+            const unsigned int slot = i % window;
+            pthread_mutex_lock(&mutex);
+            while (!ready[slot]) pthread_cond_wait(&cond_ready, &mutex);
+            pthread_mutex_unlock(&mutex);
+            job.write(i, results[slot]);
+            pthread_mutex_lock(&mutex);
+            ready[slot] = 0;
+            written = i + 1;
+            pthread_cond_broadcast(&cond_space);
+            pthread_mutex_unlock(&mutex);
+        }
+        for (unsigned int t=0; t<threads; ++t) pthread_join(tid[t], NULL);
+        pthread_cond_destroy(&cond_space);
+        pthread_cond_destroy(&cond_ready);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    protected: static void *worker_main(void *p) {
+        worker_arg *arg = static_cast<worker_arg*>(p);
+        arg->pool->worker(arg->thread);
+        return NULL;
+    }
+
+    protected: void worker(const unsigned int thread) {
+        for (;;) {
+            pthread_mutex_lock(&mutex);
+            // wait until the slot of the next job has been written out
+            while ((next < n) && (next >= written + window)) pthread_cond_wait(&cond_space, &mutex);
+            if (next >= n) {
+                pthread_mutex_unlock(&mutex);
+                return;
+            }
+            const unsigned int i = next++;
+            pthread_mutex_unlock(&mutex);
+            const unsigned int slot = i % window;
+            job.run(i, results[slot], thread);
+            pthread_mutex_lock(&mutex);
+            ready[slot] = 1;
+            pthread_cond_signal(&cond_ready);
+            pthread_mutex_unlock(&mutex);
+        }
+    }
+};
+
+// convenience wrapper
+template<class JOB>
+inline void ordered_parallel_for(JOB &job, const unsigned int n, const unsigned int threads) {
+    OrderedParallelFor<JOB> pool(job, n, threads);
+    pool.run();
+}
+
+} // end namespace
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Counter based random number streams (Philox4x32-10) described in
+ * J. K. Salmon, M. A. Moraes, R. O. Dror, D. E. Shaw.
+ * Parallel random numbers: as easy as 1, 2, 3,
+ * In Proc. International Conference for High Performance Computing, Networking, Storage and Analysis (SC11), 2011.
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+namespace util {
+
+// Philox4x32-10 block function: encrypts a 128 bit counter with a 64 bit key.
+// There is no state, so any element of any stream can be computed directly.
+class Philox {
+    public: static inline void block(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+        uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+        uint32_t k0 = key[0], k1 = key[1];
+        for (unsigned int r=0; r<10; ++r) {
+            if (r > 0) { // bump the key
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+            }
+            const uint64_t p0 = (uint64_t)0xD2511F53u * c0;
+            const uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+            const uint32_t hi0 = (uint32_t)(p0 >> 32), lo0 = (uint32_t)p0;
+            const uint32_t hi1 = (uint32_t)(p1 >> 32), lo1 = (uint32_t)p1;
+            c0 = hi1 ^ c1 ^ k0;
+            c1 = lo1;
+            c2 = hi0 ^ c3 ^ k1;
+            c3 = lo0;
+        }
+        out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+    }
+};
+
+// A stream of random numbers. The seed is the Philox key and the stream
+// number fills the upper half of the counter, so every (seed, stream) pair is
+// an independent sequence of 2^66 numbers. Setting up a stream or jumping
+// ahead in it is O(1); no locking is needed as every thread owns its streams.
+class RandomStream {
+    protected: uint32_t key[2];
+    protected: uint32_t ctr[4]; // ctr[0..1]: block number, ctr[2..3]: stream number
+    protected: uint32_t buf[4]; // output of the current block
+    protected: unsigned int pos; // next unused word in buf
+
+    public: RandomStream(const uint64_t seed = 0, const uint64_t stream = 0) {
+        set(seed, stream);
+    }
+
+    // select the stream of a seed and rewind it
+    public: inline void set(const uint64_t seed, const uint64_t stream) {
+        key[0] = (uint32_t)seed;
+        key[1] = (uint32_t)(seed >> 32);
+        ctr[2] = (uint32_t)stream;
+        ctr[3] = (uint32_t)(stream >> 32);
+        seek(0);
+    }
+
+    // position the stream at its n-th 32 bit word
+    public: inline void seek(const uint64_t n) {
+        const uint64_t b = n >> 2;
+        ctr[0] = (uint32_t)b;
+        ctr[1] = (uint32_t)(b >> 32);
+        Philox::block(ctr, key, buf);
+        pos = n & 3;
+    }
+
+    // skip the next n 32 bit words
+    public: inline void skip(const uint64_t n) {
+        const uint64_t b = ((uint64_t)ctr[1] << 32) | ctr[0];
+        seek((b << 2) + pos + n);
+    }
+
+    // uniform 32 bit integer
+    public: inline uint32_t next() {
+        if (pos == 4) {
+            if (++ctr[0] == 0) ++ctr[1];
+            Philox::block(ctr, key, buf);
+            pos = 0;
+        }
+        return buf[pos++];
+    }
+
+    // uniform 64 bit integer
+    public: inline uint64_t next64() {
+        const uint64_t hi = next();
+        return (hi << 32) | next();
+    }
+
+    // uniform double in [0,1) with the full 53 bit mantissa
+    public: inline double uniform() {
+        return (next64() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // uniform integer in [0,n) without modulo bias
+    public: inline uint32_t uniform(const uint32_t n) {
+        const uint32_t limit = -n % n; // 2^32 mod n
+        for (;;) {
+            const uint64_t m = (uint64_t)next() * n;
+            if ((uint32_t)m >= limit) return (uint32_t)(m >> 32);
+        }
+    }
+};
+
+} // end namespace
+
+#endif
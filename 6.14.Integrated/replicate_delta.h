@@ -0,0 +1,149 @@
+/*
+ * Binary delta format for replicates: the initial tree is stored once, every
+ * replicate only as the list of its grafts.
+ * Author - Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef REPLICATE_DELTA_H
+#define REPLICATE_DELTA_H
+
+#include "common.h"
+#include <istream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdint.h>
+
+// Layout, all integers little endian, doubles as their IEEE 754 bit pattern:
+//   header     "GADDELTA" u32:version u32:precision
+//              u64:length + bytes of the newick text of the initial tree
+//              u32:number of taxa, for each taxon u32:length + bytes of its name
+//   replicate  u32:replicate number (from 1) u32:number of grafts, for each graft
+//              u32:taxon u32:edge f64:offset f64:pendant
+// The nodes created by the j-th graft (from 0) of a replicate are n + 2j (internal node)
+// and n + 2j + 1 (leaf), n = number of nodes of the initial tree read from the text.
+namespace delta {
+
+static const char MAGIC[8] = {'G','A','D','D','E','L','T','A'};
+static const uint32_t VERSION = 1;
+
+// one inserted taxon: the edge of node 'edge' is split 'offset' above that node,
+// the new leaf hangs from the split point on an edge of length 'pendant'
+struct Graft {
+    uint32_t taxon;  // index in the taxon list of the header
+    uint32_t edge;
+    double offset;
+    double pendant;
+};
+
+inline void put_u32(std::string &out, const uint32_t v) {
+    for (unsigned int i=0; i<4; ++i) out += (char)((v >> (8*i)) & 0xFF);
+}
+inline void put_u64(std::string &out, const uint64_t v) {
+    for (unsigned int i=0; i<8; ++i) out += (char)((v >> (8*i)) & 0xFF);
+}
+inline void put_f64(std::string &out, const double v) {
+    uint64_t b;
+    memcpy(&b, &v, sizeof(b));
+    put_u64(out, b);
+}
+inline void put_string(std::string &out, const std::string &s) {
+    put_u32(out, s.size());
+    out += s;
+}
+
+// header of a delta file
+inline void write_header(std::string &out, const unsigned int precision, const std::string &tree_text, const std::vector<std::string> &taxa) {
+    out.append(MAGIC, 8);
+    put_u32(out, VERSION);
+    put_u32(out, precision);
+    put_u64(out, tree_text.size());
+    out += tree_text;
+    put_u32(out, taxa.size());
+    for (unsigned int i=0,iEE=taxa.size(); i<iEE; ++i) put_string(out, taxa[i]);
+}
+
+// record of replicate k (from 1)
+inline void write_replicate(std::string &out, const unsigned int k, const std::vector<Graft> &grafts) {
+    put_u32(out, k);
+    put_u32(out, grafts.size());
+    for (unsigned int j=0,jEE=grafts.size(); j<jEE; ++j) {
+        put_u32(out, grafts[j].taxon);
+        put_u32(out, grafts[j].edge);
+        put_f64(out, grafts[j].offset);
+        put_f64(out, grafts[j].pendant);
+    }
+}
+
+// reads a delta file
+class Reader {
+    protected: std::istream &is;
+
+    public: unsigned int precision;
+    public: std::string tree_text;
+    public: std::vector<std::string> taxa;
+
+    public: Reader(std::istream &is_) : is(is_), precision(6) {}
+
+    // false if this is not a delta file
+    public: bool read_header() {
+        char m[8];
+        if (!is.read(m, 8) || memcmp(m, MAGIC, 8) != 0) return false;
+        const uint32_t version = get_u32();
+        if (version != VERSION) ERROR_exit("unsupported delta file version " << version);
+        precision = get_u32();
+        tree_text.resize(get_u64());
+        if (!tree_text.empty() && !is.read(&tree_text[0], tree_text.size())) ERROR_exit("truncated delta file");
+        taxa.resize(get_u32());
+        for (unsigned int i=0,iEE=taxa.size(); i<iEE; ++i) {
+            taxa[i].resize(get_u32());
+            if (!taxa[i].empty() && !is.read(&taxa[i][0], taxa[i].size())) ERROR_exit("truncated delta file");
+        }
+        return true;
+    }
+
+    // next replicate, false at the end of the file
+    public: bool read_replicate(unsigned int &k, std::vector<Graft> &grafts) {
+        unsigned char b[4];
+        if (!is.read((char*)b, 4)) return false;
+        k = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+        grafts.resize(get_u32());
+        for (unsigned int j=0,jEE=grafts.size(); j<jEE; ++j) {
+            grafts[j].taxon = get_u32();
+            grafts[j].edge = get_u32();
+            grafts[j].offset = get_f64();
+            grafts[j].pendant = get_f64();
+            if (grafts[j].taxon >= taxa.size()) ERROR_exit("taxon " << grafts[j].taxon << " of replicate " << k << " is not in the delta file");
+        }
+        return true;
+    }
+
+    protected: inline uint64_t get(const unsigned int bytes) {
+        unsigned char b[8];
+        if (!is.read((char*)b, bytes)) ERROR_exit("truncated delta file");
+        uint64_t v = 0;
+        for (unsigned int i=bytes; i>0; --i) v = (v << 8) | b[i-1];
+        return v;
+    }
+    protected: inline uint32_t get_u32() { return (uint32_t)get(4); }
+    protected: inline uint64_t get_u64() { return get(8); }
+    protected: inline double get_f64() {
+        const uint64_t b = get(8);
+        double v;
+        memcpy(&v, &b, sizeof(v));
+        return v;
+    }
+};
+
+} // end namespace
+
+#endif
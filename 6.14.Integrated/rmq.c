@@ -3,6 +3,12 @@
  * S. Alstrup, C. Gavoille, H. Kaplan, T. Rauhe.
  * Nearest common ancestors: a survey and a new distributed algorithm,
  * In Proc. 14th annual ACM symposium on Parallel algorithms and architectures, 258-264, 2002.
+ * The minima inside the blocks of 32 values are found by scanning the block, which is one
+ * cache line with 16 bit values, with SSE4.1 or AVX2 when the cpu has them (chosen at run
+ * time; define RMQ_NO_SIMD to build without them). Without SIMD the label words of the
+ * paper answer them in constant time, which is faster than a scalar scan. The minima of
+ * whole blocks are in one sparse table of (value, position) pairs, so comparing two of
+ * them needs no lookup in the array.
  *
  * Copyright (C) 2005 Hideo Bannai (http://tlas.i.kyushu-u.ac.jp/~bannai/)
  * This program is free software; you can redistribute it and/or modify
@@ -22,33 +28,195 @@
 #include "rmq.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-/* clear the least significant x-1 bits */
-static inline INT clearbits(INT n, INT x){
-  return((n >> x) << x);
-}
+#if !defined(RMQ_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RMQ_X86
+#include <immintrin.h>
+#endif
 
-/* return floor of log n.
- * This is not implemented here in constant time as it should be, but is usually fast enough in practice.
- * (use Bit Scan Reverse on some Pentium ? processors)
- */
+#define BLOCK 32
+#define BLOCK_BITS 5
+
+typedef unsigned long long KEY; /* value << 32 | position, the smaller key is the leftmost minimum */
+
+/* kernel of the following preprocessings */
+static int rmq_kernel = RMQ_KERNEL_AUTO;
+
+/* return floor of log n */
 static inline INT intlog2(INT n){
+#ifdef __GNUC__
+  return 31 - __builtin_clz(n);
+#else
   INT res;
   for(res = 0; n > 0; n >>= 1, res++);
   return(res-1);
+#endif
 }
 
-/*
- * return position of least significant set bit. This will loop infinitely if n is 0.
- * This is not implemented here in constant time as it should be, but is usually fast enough in practice.
- * (use Bit Scan Forward on some Pentium ? processors)
- */
-static inline INT lsbset (INT n){
+/* clear the least significant x-1 bits */
+static inline INT clearbits(INT n, INT x){
+  return((n >> x) << x);
+}
+
+/* return position of least significant set bit of a non zero n */
+static inline INT lsbset(unsigned long long n){
+#ifdef __GNUC__
+  return __builtin_ctzll(n);
+#else
   INT res = 0;
   while(n % 2 == 0){
     res++; n >>= 1;
   }
   return(res);
+#endif
+}
+
+/* the bits a..e of a block of 32 */
+static inline unsigned int rangebits(INT a, INT e){
+  return (e == 31 ? 0xffffffffu : (2u << e) - 1) & (0xffffffffu << a);
+}
+
+/* every bit of a 32 bit mask twice, for the byte masks of 16 bit lanes */
+static inline unsigned long long doublebits(unsigned int m){
+  unsigned long long x = m;
+  x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+  x = (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+  x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  x = (x | (x << 2)) & 0x3333333333333333ULL;
+  x = (x | (x << 1)) & 0x5555555555555555ULL;
+  return x | (x << 1);
+}
+
+/*
+ * The SIMD scans return the offset of the leftmost minimum of b[a..e] in a block b of 32
+ * values. They read the whole block, lanes outside a..e are raised to the largest value.
+ */
+#ifdef RMQ_X86
+__attribute__((target("sse4.1")))
+static INT scan16_sse41(const unsigned short * b, INT a, INT e){
+  const __m128i va = _mm_set1_epi16(a), ve = _mm_set1_epi16(e);
+  __m128i v[4], m, lane = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+  unsigned long long eq = 0;
+  int i;
+  for(i = 0; i < 4; i++){
+    const __m128i out = _mm_or_si128(_mm_cmpgt_epi16(va, lane), _mm_cmpgt_epi16(lane, ve));
+    v[i] = _mm_or_si128(_mm_load_si128((const __m128i *) (b + 8 * i)), out);
+    lane = _mm_add_epi16(lane, _mm_set1_epi16(8));
+  }
+  m = _mm_minpos_epu16(_mm_min_epu16(_mm_min_epu16(v[0], v[1]), _mm_min_epu16(v[2], v[3])));
+  m = _mm_set1_epi16(_mm_extract_epi16(m, 0));
+  for(i = 0; i < 4; i++)
+    eq |= (unsigned long long) (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi16(v[i], m)) << (16 * i);
+  return lsbset(eq & doublebits(rangebits(a, e))) >> 1;
+}
+
+__attribute__((target("sse4.1")))
+static INT scan32_sse41(const VAL * b, INT a, INT e){
+  const __m128i va = _mm_set1_epi32(a), ve = _mm_set1_epi32(e);
+  __m128i v[8], m, lane = _mm_setr_epi32(0, 1, 2, 3);
+  unsigned int eq = 0;
+  int i;
+  for(i = 0; i < 8; i++){
+    const __m128i out = _mm_or_si128(_mm_cmpgt_epi32(va, lane), _mm_cmpgt_epi32(lane, ve));
+    v[i] = _mm_or_si128(_mm_load_si128((const __m128i *) (b + 4 * i)), out);
+    lane = _mm_add_epi32(lane, _mm_set1_epi32(4));
+  }
+  m = _mm_min_epu32(_mm_min_epu32(_mm_min_epu32(v[0], v[1]), _mm_min_epu32(v[2], v[3])),
+                    _mm_min_epu32(_mm_min_epu32(v[4], v[5]), _mm_min_epu32(v[6], v[7])));
+  m = _mm_min_epu32(m, _mm_shuffle_epi32(m, 0x4e));
+  m = _mm_min_epu32(m, _mm_shuffle_epi32(m, 0xb1));
+  for(i = 0; i < 8; i++)
+    eq |= (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v[i], m))) << (4 * i);
+  return lsbset(eq & rangebits(a, e));
+}
+
+__attribute__((target("avx2")))
+static INT scan16_avx2(const unsigned short * b, INT a, INT e){
+  const __m256i va = _mm256_set1_epi16(a), ve = _mm256_set1_epi16(e);
+  const __m256i lane0 = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m256i lane1 = _mm256_add_epi16(lane0, _mm256_set1_epi16(16));
+  const __m256i v0 = _mm256_or_si256(_mm256_load_si256((const __m256i *) b),
+                                     _mm256_or_si256(_mm256_cmpgt_epi16(va, lane0), _mm256_cmpgt_epi16(lane0, ve)));
+  const __m256i v1 = _mm256_or_si256(_mm256_load_si256((const __m256i *) (b + 16)),
+                                     _mm256_or_si256(_mm256_cmpgt_epi16(va, lane1), _mm256_cmpgt_epi16(lane1, ve)));
+  const __m256i m2 = _mm256_min_epu16(v0, v1);
+  const __m128i m1 = _mm_minpos_epu16(_mm_min_epu16(_mm256_castsi256_si128(m2), _mm256_extracti128_si256(m2, 1)));
+  const __m256i m = _mm256_set1_epi16(_mm_extract_epi16(m1, 0));
+  const unsigned long long eq = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi16(v0, m))
+    | ((unsigned long long) (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi16(v1, m)) << 32);
+  return lsbset(eq & doublebits(rangebits(a, e))) >> 1;
+}
+
+__attribute__((target("avx2")))
+static INT scan32_avx2(const VAL * b, INT a, INT e){
+  const __m256i va = _mm256_set1_epi32(a), ve = _mm256_set1_epi32(e);
+  __m256i v[4], m, lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m128i h;
+  unsigned int eq = 0;
+  int i;
+  for(i = 0; i < 4; i++){
+    const __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(va, lane), _mm256_cmpgt_epi32(lane, ve));
+    v[i] = _mm256_or_si256(_mm256_load_si256((const __m256i *) (b + 8 * i)), out);
+    lane = _mm256_add_epi32(lane, _mm256_set1_epi32(8));
+  }
+  m = _mm256_min_epu32(_mm256_min_epu32(v[0], v[1]), _mm256_min_epu32(v[2], v[3]));
+  h = _mm_min_epu32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+  h = _mm_min_epu32(h, _mm_shuffle_epi32(h, 0x4e));
+  h = _mm_min_epu32(h, _mm_shuffle_epi32(h, 0xb1));
+  m = _mm256_broadcastd_epi32(h);
+  for(i = 0; i < 4; i++)
+    eq |= (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v[i], m))) << (8 * i);
+  return lsbset(eq & rangebits(a, e));
+}
+#endif
+
+/* the kernel to use for the requested one */
+static int resolve_kernel(int kernel){
+#ifdef RMQ_X86
+  __builtin_cpu_init();
+  if((kernel == RMQ_KERNEL_AUTO || kernel == RMQ_KERNEL_AVX2) && __builtin_cpu_supports("avx2"))
+    return RMQ_KERNEL_AVX2;
+  if((kernel == RMQ_KERNEL_AUTO || kernel == RMQ_KERNEL_SSE41) && __builtin_cpu_supports("sse4.1"))
+    return RMQ_KERNEL_SSE41;
+#endif
+  (void) kernel;
+  return RMQ_KERNEL_SCALAR;
+}
+
+int rm_query_kernel(int kernel){
+  rmq_kernel = kernel;
+  return resolve_kernel(kernel);
+}
+
+/* offset of the leftmost minimum in positions a..e of block i */
+static inline INT scan(const struct rmqinfo * info, INT i, INT a, INT e){
+  INT v;
+#ifdef RMQ_X86
+  if(info->kernel == RMQ_KERNEL_AVX2)
+    return info->values16 != NULL ? scan16_avx2(info->values16 + (i << BLOCK_BITS), a, e)
+                                   : scan32_avx2(info->values32 + (i << BLOCK_BITS), a, e);
+  if(info->kernel == RMQ_KERNEL_SSE41)
+    return info->values16 != NULL ? scan16_sse41(info->values16 + (i << BLOCK_BITS), a, e)
+                                   : scan32_sse41(info->values32 + (i << BLOCK_BITS), a, e);
+#endif
+  /* the lowest set bit from a on in the label of e, e itself if there is none */
+  v = clearbits(info->labels[(i << BLOCK_BITS) + e], a);
+  return v == 0 ? e : lsbset(v);
+}
+
+static inline VAL value(const struct rmqinfo * info, INT pos){
+  return info->values16 != NULL ? info->values16[pos] : info->values32[pos];
+}
+
+static inline KEY key(const struct rmqinfo * info, INT pos){
+  return ((KEY) value(info, pos) << 32) | pos;
+}
+
+/* size bytes aligned to a cache line, NULL if out of memory */
+static void * alloc_aligned(size_t size){
+  void * p;
+  return posix_memalign(&p, 64, size) == 0 ? p : NULL;
 }
 
 /*
@@ -80,79 +248,71 @@ INT rm_query_naive(VAL * a, INT x, INT y){
  */
 struct rmqinfo * rm_query_preprocess(VAL * array, INT alen){
   struct rmqinfo * info;
-  INT i, j, g, rows, cols, block_cnt, rowelmlen;
-  INT * block_min, **sparse, *labels;
-  INT gstack[32], gstacksize = 0;
+  INT i, k, blocks, padded, cols, g;
+  INT gstack[BLOCK], gstacksize = 0;
+  VAL maxval = 0;
+  KEY * row, * prev;
 
   info = (struct rmqinfo *) malloc(sizeof(struct rmqinfo));
-  /* divide input array into blocks of size 32.
-   * block_cnt is the number of such blocks.
-   * block_minpos is an array that contains the
-   * minimum positions in each block. */
-  block_cnt = ((alen-1) >> 5) + 1;
-  block_min = (INT *) malloc (sizeof(INT) * block_cnt);
-  for(i = j = 0; i < alen; i++){
-    if(i % 32 == 0){
-      if(i > 0) j++;
-      block_min[j] = i;
-    } else if(VAL_LT(array[i],array[block_min[j]])){
-      block_min[j] = i;
-    }
-  }
-  /* make a sparse table for the rmq of the blocks.
-   * sparse[j][i] represents the minimum in
-   * block[i] to block[i + 2^{j+1} - 1] */
-  rows = intlog2(block_cnt);
-  sparse = NULL;
-  /* sparse tables aren't needed when the array is less than 32 elements long */
-  if(rows > 0){
-    sparse = (INT **) malloc (sizeof(INT *) * rows);
-    /* first row is min of adjacent entries. Table entries are
-     * converted to positions in original array */
-    sparse[0] = (INT *) malloc (sizeof(INT) * (block_cnt - 1));
-    for(i = 0; i < block_cnt - 1; i++){
-      if(VAL_LT(array[block_min[i+1]],array[block_min[i]]))
-        sparse[0][i] = block_min[i+1];
-      else
-        sparse[0][i] = block_min[i];
-    }
-    for(j = 1; j < rows; j++){
-      rowelmlen = 2 << j;    /* 2^{j+1} */
-      cols = block_cnt - rowelmlen + 1;
-      sparse[j] = (INT *) malloc (sizeof(INT) * cols);
-      for(i = 0; i < cols; i++){
-        if(VAL_LT(array[sparse[j-1][i + (rowelmlen >> 1)]],array[sparse[j-1][i]]))
-          sparse[j][i] = sparse[j-1][i + (rowelmlen >> 1)];
-	else
-	  sparse[j][i] = sparse[j-1][i];
-      }
-    }
+  info->alen = alen;
+  info->array = array;
+  info->kernel = resolve_kernel(rmq_kernel);
+  /* divide input array into blocks of size 32, the last one is
+   * filled up with the largest value */
+  blocks = ((alen-1) >> BLOCK_BITS) + 1;
+  padded = blocks << BLOCK_BITS;
+  info->blocks = blocks;
+  for(i = 0; i < alen; i++)
+    if(VAL_LT(maxval,array[i])) maxval = array[i];
+  info->values16 = NULL;
+  info->values32 = NULL;
+  if(maxval <= 0xffff){
+    info->values16 = (unsigned short *) alloc_aligned(sizeof(unsigned short) * padded);
+    for(i = 0; i < alen; i++) info->values16[i] = array[i];
+    for(; i < padded; i++) info->values16[i] = 0xffff;
+  } else {
+    info->values32 = (VAL *) alloc_aligned(sizeof(VAL) * padded);
+    memcpy(info->values32, array, sizeof(VAL) * alen);
+    for(i = alen; i < padded; i++) info->values32[i] = (VAL) -1;
   }
-
-  /* create integers for constant time rmq inside the blocks
+  /* without SIMD, create integers for constant time rmq inside the blocks
    * In each block:
    * - g[i]: the first position to the left of i
    * where array[g[i]] < array[i] (or -1 if there is no such position).
    * - l[i]: the jth bit of l[i] is 1 iff j is the first
    * position left of i where array[j] < array[i] */
-  labels = (INT *) malloc(sizeof(INT) * alen);
-  for(i = 0; i < alen; i++){
-    if(i % 32 == 0) gstacksize = 0;
-    labels[i] = 0;
-    while(gstacksize > 0 && (VAL_LT(array[i],array[gstack[gstacksize-1]]))){
-      gstacksize--;
+  info->labels = NULL;
+  if(info->kernel == RMQ_KERNEL_SCALAR){
+    info->labels = (INT *) alloc_aligned(sizeof(INT) * padded);
+    for(i = 0; i < padded; i++){
+      if(i % BLOCK == 0) gstacksize = 0;
+      info->labels[i] = 0;
+      while(gstacksize > 0 && (VAL_LT(value(info, i),value(info, gstack[gstacksize-1])))){
+        gstacksize--;
+      }
+      if(gstacksize > 0){
+        g = gstack[gstacksize-1];
+        info->labels[i] = info->labels[g] | (1u << (g % BLOCK));
+      }
+      gstack[gstacksize++] = i;
     }
-    if(gstacksize > 0){
-      g = gstack[gstacksize-1];
-      labels[i] = labels[g] | (1 << (g%32));
+  }
+  /* make a sparse table for the rmq of the blocks.
+   * row k holds the minimum of block[i] to block[i + 2^k - 1],
+   * row 0 the minima of the blocks themselves */
+  info->rows = intlog2(blocks) + 1;
+  info->sparse = (KEY *) alloc_aligned(sizeof(KEY) * info->rows * blocks);
+  for(i = 0; i < blocks; i++)
+    info->sparse[i] = key(info, (i << BLOCK_BITS) + scan(info, i, 0, BLOCK - 1));
+  for(k = 1; k < info->rows; k++){
+    prev = info->sparse + (k-1) * blocks;
+    row = prev + blocks;
+    cols = blocks - (1 << k) + 1;
+    for(i = 0; i < cols; i++){
+      const KEY l = prev[i], r = prev[i + (1 << (k-1))];
+      row[i] = r < l ? r : l;
     }
-    gstack[gstacksize++] = i;
   }
-  info->array = array;
-  info->sparse = sparse;
-  info->block_min = block_min;
-  info->labels = labels;
-  info->alen = alen;
   return info;
 }
 
@@ -164,65 +324,39 @@ struct rmqinfo * rm_query_preprocess(VAL * array, INT alen){
  * in the range, the smallest index is returned.
  */
 INT rm_query(const struct rmqinfo * info, INT l, INT r){
-  INT blocknum_l, blocknum_r, blockdiff, blockmin;
-  INT tmp, v, bpos;
-  INT v1, v2, pos1, pos2;
+  INT blocknum_l, blocknum_r, tmp, k;
+  KEY best, v;
+  const KEY * row;
   if(l == r) return l;
   if(l > r){
     tmp = l; l = r; r = tmp;
   }
-  blocknum_l = (l >> 5); blocknum_r = (r >> 5);  /* obtain which blocks l and r will come in */
-  bpos = blocknum_l << 5;
-  switch(blockdiff = blocknum_r - blocknum_l){
-  case 0: /* one inblock query in block blocknum_l. from position (l%32) to (r%32) */
-    v = clearbits(info->labels[r], l % 32); /* clear (x - 1) insiginificant bits */
-    return ((v == 0) ? r : bpos + lsbset(v));
-    break;
-  case 1:  /* two inblock queries. in block blocknum_l and blocknum_r.
-	    * in blocknum_l: postion (l%32) to 31
-	    * in blocknum_r: postion 0 to (r%32) */
-    tmp = bpos + 31;
-    v1 = clearbits(info->labels[tmp], l%32);
-    v2 = info->labels[r];
-    pos1 = (v1 == 0) ? tmp : (bpos + lsbset(v1));
-    pos2 = (v2 == 0) ? r : lsbset(v2) + (blocknum_r<<5);
-    return((VAL_LT(info->array[pos2],info->array[pos1])) ? pos2 : pos1);
-    break;
-  default: /* two inblock queries, and a query over the blocks.
-	    * in blocknum_l: postion (l%32) to 31
-	    * in blocknum_r: postion 0 to (r%32).
-	    * block (blocknum_l+1) to (blonum_r-1) */
-    tmp = bpos + 31;
-    v1 = clearbits(info->labels[tmp], l%32);
-    v2 = info->labels[r];
-    pos1 = (v1 == 0) ? tmp : (bpos + lsbset(v1));
-    pos2 = (v2 == 0) ? r : lsbset(v2) + (blocknum_r<<5);
-    if(blockdiff == 2){ /* (blocknum_l+1) == (blonum_r-1) */
-      blockmin = info->block_min[blocknum_l+1];
-    } else {
-      /* rmq of blocknum_l+1 to blocknum_r-1 */
-      int t1, t2, k;
-      k = intlog2(blockdiff-1) - 1;
-      t1 = info->sparse[k][blocknum_l+1];
-      t2 = info->sparse[k][blocknum_r - (1 << (k+1))];
-      blockmin = (VAL_LT(info->array[t2],info->array[t1])) ? t2 : t1;
-    }
-    pos1 = (VAL_LT(info->array[blockmin],info->array[pos1])) ? blockmin : pos1;
-    return((VAL_LT(info->array[pos2],info->array[pos1])) ? pos2 : pos1);
+  blocknum_l = (l >> BLOCK_BITS); blocknum_r = (r >> BLOCK_BITS);  /* obtain which blocks l and r will come in */
+  if(blocknum_l == blocknum_r) /* one inblock query */
+    return (blocknum_l << BLOCK_BITS) + scan(info, blocknum_l, l % BLOCK, r % BLOCK);
+  /* two inblock queries. in block blocknum_l from position (l%32) to 31,
+   * in blocknum_r from position 0 to (r%32) */
+  best = key(info, (blocknum_l << BLOCK_BITS) + scan(info, blocknum_l, l % BLOCK, BLOCK - 1));
+  v = key(info, (blocknum_r << BLOCK_BITS) + scan(info, blocknum_r, 0, r % BLOCK));
+  if(v < best) best = v;
+  /* and a query over the blocks (blocknum_l+1) to (blocknum_r-1) */
+  if(blocknum_r - blocknum_l > 1){
+    k = intlog2(blocknum_r - blocknum_l - 1);
+    row = info->sparse + k * info->blocks;
+    v = row[blocknum_l + 1];
+    if(v < best) best = v;
+    v = row[blocknum_r - (1 << k)];
+    if(v < best) best = v;
   }
+  return (INT) best;
 }
 
 void rm_free(struct rmqinfo * info){
-  INT block_cnt, rows, i;
-  block_cnt = ((info->alen-1) >> 5) + 1;
-  rows = intlog2(block_cnt);
-  for(i = 0; i < rows; i++)
-    free(info->sparse[i]);
   free(info->sparse);
-  free(info->block_min);
+  free(info->values16);
+  free(info->values32);
   free(info->labels);
   free(info);
 }
 
 #endif /*RMQ_C_*/
-
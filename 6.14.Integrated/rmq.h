@@ -34,14 +34,24 @@ extern "C" {
     /* compare the value inside the array */
 #define VAL_LT(x,y) x < y
 
+    /* kernels of the scans inside the blocks of 32 values */
+#define RMQ_KERNEL_AUTO 0   /* the fastest one the cpu supports */
+#define RMQ_KERNEL_SCALAR 1 /* label words instead of a scan */
+#define RMQ_KERNEL_SSE41 2
+#define RMQ_KERNEL_AVX2 3
+
     /* a struct to hold preprocessed information */
 
     struct rmqinfo {
         INT alen;     // length of original array
         VAL * array;  // pointer to original array
-        INT ** sparse;
-        INT * block_min;
-        INT * labels;
+        INT blocks;   // number of blocks of 32 values
+        INT rows;     // rows of the sparse table
+        unsigned long long * sparse; // one table, entry k * blocks + i is (value << 32 | position) of the minimum of blocks i to i + 2^k - 1
+        unsigned short * values16;   // the values in 16 bits if they all fit, else NULL
+        VAL * values32;              // else a copy of them; both are padded to whole blocks with the largest value
+        INT * labels;                // with RMQ_KERNEL_SCALAR the label words of the minima inside the blocks, else NULL
+        int kernel;   // RMQ_KERNEL_* of the scans
     };
 
     /*
@@ -67,6 +77,13 @@ extern "C" {
      */
     INT rm_query(const struct rmqinfo * info, INT x, INT y);
 
+    /*
+     * Select the kernel of the following calls of rm_query_preprocess(), the queries use
+     * the one their rmqinfo was preprocessed with. Returns the selected kernel, which is
+     * RMQ_KERNEL_SCALAR if the cpu does not support the requested one. Not thread safe.
+     */
+    int rm_query_kernel(int kernel);
+
     /*
      * Free all memory associated with rmqinfo EXCEPT the original array
      */
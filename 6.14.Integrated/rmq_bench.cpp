@@ -0,0 +1,131 @@
+/* Microbenchmark of the range minimum queries of rmq.c (make bench-rmq)
+ * Author - Avinash Ramu
+ * usage - ./rmq_bench [length] [queries] [seed]
+ * Times preprocessing and queries of every kernel the cpu supports against rm_query_naive
+ * and the previous implementation of rmq.c ("old", see rmq_old.c) on two sequences of the
+ * given length (default 1000000) that look like the levels of the INORDER steps of a tree:
+ * a shallow one whose values fit in 16 bits and a deep one whose values do not. The
+ * queries are short (inside about one block) or anywhere in the sequence; the naive scan
+ * gets at most 1000 of the long ones.
+ * Exits with 1 if a kernel or the previous implementation disagrees with rm_query_naive.
+ */
+
+#include "rmq.h"
+#include "rmq_old.h"
+#include "random.h"
+#include "stats.h"
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+
+static const char *const kernel_names[] = {"auto", "scalar", "sse4.1", "avx2"};
+static const unsigned int NAIVE_LONG = 1000;
+
+// a walk of +-1 steps from 0 that goes up with probability up, never below 0
+void walk(util::RandomStream &rng, const unsigned int n, const double up, vector<VAL> &a) {
+  a.resize(n);
+  VAL level = 0;
+  for (unsigned int i=0; i<n; ++i) {
+    a[i] = level;
+    if ((level == 0) || (rng.uniform() < up)) ++level; else --level;
+  }
+}
+
+// query pairs of at most span positions apart, or anywhere if span is 0
+void queries(util::RandomStream &rng, const unsigned int n, const unsigned int count, const unsigned int span, vector<INT> &x, vector<INT> &y) {
+  x.resize(count);
+  y.resize(count);
+  for (unsigned int i=0; i<count; ++i) {
+    x[i] = rng.uniform(n);
+    y[i] = span == 0 ? rng.uniform(n) : (x[i] + rng.uniform(span)) % n;
+  }
+}
+
+// nanoseconds per query, the answers go to z
+double time_queries(const rmqinfo *info, VAL *a, const vector<INT> &x, const vector<INT> &y, const unsigned int count, vector<INT> &z) {
+  z.resize(count);
+  const double start = util::wall_time();
+  if (info == NULL) for (unsigned int i=0; i<count; ++i) z[i] = rm_query_naive(a, x[i], y[i]);
+  else for (unsigned int i=0; i<count; ++i) z[i] = rm_query(info, x[i], y[i]);
+  return (util::wall_time() - start) * 1e9 / (count == 0 ? 1 : count);
+}
+
+// the same with the previous implementation
+double time_queries(const rmqlabels *info, const vector<INT> &x, const vector<INT> &y, const unsigned int count, vector<INT> &z) {
+  z.resize(count);
+  const double start = util::wall_time();
+  for (unsigned int i=0; i<count; ++i) z[i] = rm_query_labels(info, x[i], y[i]);
+  return (util::wall_time() - start) * 1e9 / (count == 0 ? 1 : count);
+}
+
+// number of answers that differ from the naive ones
+unsigned int mismatches(const vector<INT> &z, const vector<INT> &naive) {
+  unsigned int bad = 0;
+  for (unsigned int i=0,iEE=naive.size(); i<iEE; ++i) if (z[i] != naive[i]) ++bad;
+  return bad;
+}
+
+int main(int argc, char* argv[]) {
+  const unsigned int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  const unsigned int count = argc > 2 ? atoi(argv[2]) : 1000000;
+  const uint64_t seed = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+  if (n < 2) {
+    cout<<"The sequence needs at least 2 values! Exiting!\n";
+    exit(1);
+  }
+
+  util::RandomStream rng(seed, 0);
+  vector<INT> sx, sy, lx, ly;
+  queries(rng, n, count, 48, sx, sy);
+  queries(rng, n, count, 0, lx, ly);
+  const unsigned int naive_long = count < NAIVE_LONG ? count : NAIVE_LONG;
+
+  unsigned int bad = 0;
+  printf("%-8s %-8s %13s %14s %13s\n", "levels", "kernel", "preprocess_ms", "short_ns/query", "long_ns/query");
+  for (unsigned int s=0; s<2; ++s) {
+    vector<VAL> a;
+    walk(rng, n, s == 0 ? 0.5 : 0.6, a);
+    const char *levels = s == 0 ? "shallow" : "deep";
+    vector<INT> short_naive, long_naive, z;
+    const double ns_short = time_queries(NULL, &a[0], sx, sy, count, short_naive);
+    const double ns_long = time_queries(NULL, &a[0], lx, ly, naive_long, long_naive);
+    printf("%-8s %-8s %13s %14.1f %13.1f\n", levels, "naive", "-", ns_short, ns_long);
+
+    {
+      const double start = util::wall_time();
+      rmqlabels *info = rm_query_labels_preprocess(&a[0], n);
+      const double ms = (util::wall_time() - start) * 1e3;
+      const double q_short = time_queries(info, sx, sy, count, z);
+      bad += mismatches(z, short_naive);
+      const double q_long = time_queries(info, lx, ly, count, z);
+      z.resize(naive_long);
+      bad += mismatches(z, long_naive);
+      printf("%-8s %-8s %13.2f %14.1f %13.1f\n", levels, "old", ms, q_short, q_long);
+      rm_labels_free(info);
+    }
+
+    for (int k=RMQ_KERNEL_SCALAR; k<=RMQ_KERNEL_AVX2; ++k) {
+      if (rm_query_kernel(k) != k) continue;
+      const double start = util::wall_time();
+      rmqinfo *info = rm_query_preprocess(&a[0], n);
+      const double ms = (util::wall_time() - start) * 1e3;
+      const double q_short = time_queries(info, &a[0], sx, sy, count, z);
+      bad += mismatches(z, short_naive);
+      const double q_long = time_queries(info, &a[0], lx, ly, count, z);
+      z.resize(naive_long);
+      bad += mismatches(z, long_naive);
+      printf("%-8s %-8s %13.2f %14.1f %13.1f%s\n", levels, kernel_names[k], ms, q_short, q_long,
+             info->values16 != NULL ? "  (16 bit)" : "");
+      rm_free(info);
+    }
+  }
+  rm_query_kernel(RMQ_KERNEL_AUTO);
+  if (bad != 0) {
+    printf("%u answers differ from rm_query_naive!\n", bad);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * The range minimum queries of rmq.c before its SIMD scans and flat sparse table, kept for
+ * rmq_bench (see rmq_old.c).
+ *
+ * Copyright (C) 2005 Hideo Bannai (http://tlas.i.kyushu-u.ac.jp/~bannai/)
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef RMQ_OLD_H_
+#define RMQ_OLD_H_
+
+#include "rmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* a struct to hold preprocessed information */
+
+    struct rmqlabels {
+        INT alen;     // length of original array
+        VAL * array;  // pointer to original array
+        INT ** sparse;
+        INT * block_min;
+        INT * labels;
+    };
+
+    /*
+     * Preprocess array in linear time so that range minimum
+     * queries can be conducted in constant time.
+     */
+    struct rmqlabels * rm_query_labels_preprocess(VAL * a, INT alen);
+
+    /*
+     * Return the position in array which gives the minimum value
+     * in the subarray rmqlabels.array[x..y] using preprocessed information.
+     * When there are multiple positions with the same minimum value,
+     * in the range, the smallest index is returned.
+     */
+    INT rm_query_labels(const struct rmqlabels * info, INT x, INT y);
+
+    /*
+     * Free all memory associated with rmqlabels EXCEPT the original array
+     */
+    void rm_labels_free(struct rmqlabels * info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*RMQ_OLD_H_*/
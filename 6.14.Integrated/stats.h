@@ -0,0 +1,162 @@
+/*
+ * Wall time and call counts of the phases of a job, counters of events, a JSON
+ * report of them and progress lines with rate and ETA.
+ * Author - Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+namespace util {
+
+// seconds since some fixed point in the past
+inline double wall_time() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// largest resident set size of the process so far in kB
+inline unsigned long peak_rss_kb() {
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    #ifdef __APPLE__
+    return ru.ru_maxrss / 1024; // bytes
+    #else
+    return ru.ru_maxrss;
+    #endif
+}
+
+// s as a JSON string
+inline void json_string(std::ostream &os, const std::string &s) {
+    os << '"';
+    for (unsigned int i=0,iEE=s.size(); i<iEE; ++i) {
+        const unsigned char c = s[i];
+        if ((c == '"') || (c == '\\')) os << '\\' << c;
+        else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            os << buf;
+        } else os << c;
+    }
+    os << '"';
+}
+
+// phases and counters are numbered by the caller, their names are given once to create()
+// time() adds the wall time since a given moment to a phase and returns the current time,
+// so consecutive phases are timed with one clock reading each:
+//   double t = wall_time();
+//   ...  t = stats.time(PARSE, t);
+//   ...  t = stats.time(BUILD, t);
+class Stats {
+    protected: std::vector<const char*> phase_names, counter_names;
+    public: std::vector<double> seconds;
+    public: std::vector<unsigned long long> calls;
+    public: std::vector<unsigned long long> counters;
+
+    public: void create(const char *const *phases, const unsigned int n_phases, const char *const *counters_, const unsigned int n_counters) {
+        phase_names.assign(phases, phases + n_phases);
+        counter_names.assign(counters_, counters_ + n_counters);
+        seconds.assign(n_phases, 0);
+        calls.assign(n_phases, 0);
+        counters.assign(n_counters, 0);
+    }
+
+    public: inline double time(const unsigned int phase, const double since) {
+        const double now = wall_time();
+        seconds[phase] += now - since;
+        ++calls[phase];
+        return now;
+    }
+
+    public: inline void count(const unsigned int counter, const unsigned long long n = 1) { counters[counter] += n; }
+
+    public: void clear() {
+        seconds.assign(seconds.size(), 0);
+        calls.assign(calls.size(), 0);
+        counters.assign(counters.size(), 0);
+    }
+
+    // add the numbers of other, which has the same phases and counters
+    public: void add(const Stats &other) {
+        for (unsigned int i=0,iEE=seconds.size(); i<iEE; ++i) {
+            seconds[i] += other.seconds[i];
+            calls[i] += other.calls[i];
+        }
+        for (unsigned int i=0,iEE=counters.size(); i<iEE; ++i) counters[i] += other.counters[i];
+    }
+
+    // "phases": {"name": {"seconds": s, "calls": c}, ...}, "counters": {"name": n, ...}
+    // phases that were never entered are left out
+    public: void json(std::ostream &os) const {
+        os << "\"phases\": {";
+        bool first = true;
+        for (unsigned int i=0,iEE=seconds.size(); i<iEE; ++i) {
+            if (calls[i] == 0) continue;
+            if (!first) os << ", ";
+            first = false;
+            json_string(os, phase_names[i]);
+            os << ": {\"seconds\": " << seconds[i] << ", \"calls\": " << calls[i] << '}';
+        }
+        os << "}, \"counters\": {";
+        for (unsigned int i=0,iEE=counters.size(); i<iEE; ++i) {
+            if (i != 0) os << ", ";
+            json_string(os, counter_names[i]);
+            os << ": " << counters[i];
+        }
+        os << '}';
+    }
+};
+
+// progress lines "done/total, rate, ETA" at most every interval seconds
+class Progress {
+    protected: std::ostream *os;
+    protected: double interval, start, last;
+    protected: unsigned int total;
+    protected: const char *what; // name of the items
+
+    public: Progress() : os(NULL), interval(0), start(0), last(0), total(0), what("") {}
+
+    // interval 0 turns the lines off
+    public: void create(std::ostream &os_, const double interval_, const unsigned int total_, const char *what_) {
+        os = &os_;
+        interval = interval_;
+        total = total_;
+        what = what_;
+        start = last = wall_time();
+    }
+
+    // done of total items are finished
+    public: inline void update(const unsigned int done) {
+        if (interval <= 0) return;
+        const double now = wall_time();
+        if ((now - last < interval) && (done != total)) return;
+        last = now;
+        const double elapsed = now - start;
+        const double rate = elapsed > 0 ? done / elapsed : 0;
+        char buf[160];
+        snprintf(buf, sizeof(buf), "%u/%u %s, %.3g %s/s, %.1f s elapsed, ETA %.1f s\n", done, total, what, rate, what,
+                 elapsed, rate > 0 ? (total - done) / rate : 0.0);
+        *os << buf << std::flush;
+    }
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Checks of the newick parser of GatorADD, run by "make test".
+# usage - ./test_parser.sh gatoradd
+# Every malformed tree has to be refused with an error message and exit code 1, not crash.
+
+GATORADD=$1
+WORK=test_work
+
+if [ ! -x "$GATORADD" ]; then
+  echo "usage - ./test_parser.sh gatoradd"
+  exit 1
+fi
+GATORADD=`cd \`dirname $GATORADD\` && pwd`/`basename $GATORADD`
+mkdir -p $WORK || exit 1
+printf 'new0\tRANDOM\n' > $WORK/add.txt
+
+bad=0
+# refused tree message: the tree is refused with the message
+refused() {
+  echo "$1" > $WORK/tree.tre
+  # in the work directory, where GatorADD writes its data logs
+  (cd $WORK && $GATORADD tree.tre add.txt 1 out.txt -v 0 > log.txt 2>&1)
+  rc=$?
+  if [ $rc -ne 1 ] || ! grep -q "$2" $WORK/log.txt; then
+    echo "FAILED: $1 exited with $rc, expected 1 and \"$2\""
+    bad=`expr $bad + 1`
+  else
+    echo "ok: $1"
+  fi
+}
+
+# branch lengths after '(' or ',' belong to no node
+refused "(:1,b);" "branch length without a node"
+refused "(a,:2);" "branch length without a node"
+
+rm -rf $WORK
+if [ $bad -ne 0 ]; then
+  echo "$bad parser check(s) failed"
+  exit 1
+fi
+echo "all parser checks passed"
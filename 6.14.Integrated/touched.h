@@ -0,0 +1,63 @@
+/*
+ * Set of array positions that were written to, used to bring a modified copy
+ * of a data structure back to its original in time proportional to the changes.
+ * Author - Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TOUCHED_H
+#define TOUCHED_H
+
+#include <vector>
+
+namespace util {
+
+// positions 0..n-1 of one or more parallel arrays; every position is listed once
+// no matter how often it was touched. restoring a position that was not changed
+// is harmless, so structures may touch generously.
+// O(1) touch, O(number of touched positions) clear
+class TouchedSet {
+    protected: std::vector<char> flag;
+    protected: std::vector<unsigned int> list;
+
+    // empty set for positions 0..n-1
+    public: inline void create(const unsigned int n) {
+        flag.assign(n, 0);
+        list.clear();
+    }
+
+    // allow positions up to n-1
+    public: inline void resize(const unsigned int n) {
+        if (n > flag.size()) flag.resize(n, 0);
+    }
+
+    public: inline void touch(const unsigned int i) {
+        if (!flag[i]) {
+            flag[i] = 1;
+            list.push_back(i);
+        }
+    }
+
+    public: inline bool contains(const unsigned int i) const { return flag[i] != 0; }
+
+    // number of touched positions and the k-th of them (in order of their first touch)
+    public: inline unsigned int size() const { return list.size(); }
+    public: inline unsigned int operator[](const unsigned int k) const { return list[k]; }
+
+    public: inline void clear() {
+        for (unsigned int k=0,kEE=list.size(); k<kEE; ++k) flag[list[k]] = 0;
+        list.clear();
+    }
+};
+
+} // end namespace
+
+#endif
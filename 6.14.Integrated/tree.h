@@ -32,6 +32,37 @@ namespace aw {
 enum traversal_states {PREORDER, INORDER, POSTORDER, NOTRAVERSAL};
 static const unsigned int NONODE = UINT_MAX;
 
+// nodes of a tree in the order of the steps of the DFS from its root; a tree builds them for
+// the first traversal that asks for them and keeps them until one of its edges changes or its
+// root moves, so repeated traversals of an unchanged tree are scans of arrays
+class TraversalOrders {
+    public: std::vector<unsigned int> preorder, postorder;
+    protected: unsigned int root;
+    protected: bool valid;
+
+    public: TraversalOrders() : root(NONODE), valid(false) {}
+
+    public: inline void invalidate() { valid = false; }
+
+    // true if they are the orders of a tree with this root that has not changed since create()
+    public: inline bool current(const unsigned int root_) const { return valid && (root == root_); }
+
+    public: template<class TREE> void create(TREE &tree) {
+        const unsigned int n = tree.node_size();
+        preorder.clear(); preorder.reserve(n);
+        postorder.clear(); postorder.reserve(n);
+        for (typename TREE::iterator_dfs v=tree.begin_dfs(),vEE=tree.end_dfs(); v!=vEE; ++v) {
+            switch (v.direction) {
+                case PREORDER: preorder.push_back(v.idx); break;
+                case POSTORDER: postorder.push_back(v.idx); break;
+                default: break;
+            }
+        }
+        root = tree.root;
+        valid = true;
+    }
+};
+
 template<class VALUE>
 class TreeTemplate {
     // some data type definitions
@@ -45,6 +76,10 @@ class TreeTemplate {
         public: inline unsigned int size() {
             return data.size();
         }
+        // the i-th adjacent node
+        public: inline unsigned int operator[](const unsigned int i) {
+            return data[i];
+        }
         // insert an adjacent node
         public: inline void insert(const unsigned int v) {
             data.push_back(v);
@@ -191,6 +226,9 @@ class TreeTemplate {
     // keeps track of number of edges
     protected: unsigned int edge_count;
 
+    // traversal orders, see orders()
+    protected: TraversalOrders orders_;
+
     // default constructor
     public: TreeTemplate() {
         clear();
@@ -200,6 +238,7 @@ class TreeTemplate {
         root = NONODE;
         edge_count = 0;
         nodes23.clear();
+        orders_.invalidate();
     }
 
     // return the id of a node
@@ -210,6 +249,8 @@ class TreeTemplate {
         r.nodes23.swap(nodes23);
         util::swap(root, r.root);
         util::swap(edge_count, r.edge_count);
+        orders_.invalidate();
+        r.orders_.invalidate();
     }
 
     // true if the tree contains no nodes (and no edges)
@@ -290,11 +331,13 @@ class TreeTemplate {
         adjacent(v).insert(u);
         adjacent(u).insert(v);
         ++edge_count;
+        orders_.invalidate();
     }
 
     // remove an edge between 2 nodes
     // return false edge does not exist
     public: inline bool remove_edge(const unsigned int v, const unsigned int u) {
+        orders_.invalidate();
         if (!adjacent(v).remove(u)) return false;
         if (!adjacent(u).remove(v)) return false;
         --edge_count;
@@ -313,6 +356,18 @@ class TreeTemplate {
         return l;
     }
 
+    // the nodes in the order of the PREORDER and POSTORDER steps of the DFS from the root
+    // (the INORDER steps are the sequence of the LCA, which builds its own); built by the
+    // first call and kept until add_edge() or remove_edge() (not by changes through
+    // adjacent()) or a new root
+    // the first call writes the cache, so unlike the traversals not for several threads at once
+    public: inline const std::vector<unsigned int> &preorder() { return orders().preorder; }
+    public: inline const std::vector<unsigned int> &postorder() { return orders().postorder; }
+    protected: inline TraversalOrders &orders() {
+        if (!orders_.current(root)) orders_.create(*this);
+        return orders_;
+    }
+
 //     // delete a node
 //     // note: results in the change of the id of the most recent added node
 //     public: inline bool del_node(const unsigned int i) { return del_node(node(i)); }
@@ -21,12 +21,18 @@
 #include <iostream>
 #include <iomanip>
 #include <stack>
+#include <algorithm>
+#include <string.h>
+#include <limits.h>
 #include <vector>
 #include <boost/foreach.hpp>
-#ifdef NOHASH
+#include <pthread.h>
 #include <map>
+#ifdef NOHASH
+#include <set>
 #else
 #include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
 #endif
 
 
@@ -34,11 +40,160 @@ namespace aw {
 
 using namespace std;
 
-#ifdef NOHASH
-typedef std::map<unsigned int,std::string> idx2name;
-#else
-typedef boost::unordered_map<unsigned int,std::string> idx2name;
-#endif
+// every distinct name once, shared by all trees of the program
+// the strings never move and are never freed, so the address of one identifies the name
+// adding names is thread safe, reading the string behind an address needs no lock
+class NamePool {
+    #ifdef NOHASH
+    protected: std::set<std::string> names;
+    #else
+    protected: boost::unordered_set<std::string> names;
+    #endif
+    protected: std::string key; // reused for the lookups
+    protected: pthread_mutex_t mutex;
+
+    protected: NamePool(const NamePool &);
+    protected: NamePool& operator=(const NamePool &);
+
+    public: NamePool() { pthread_mutex_init(&mutex, NULL); }
+    public: ~NamePool() { pthread_mutex_destroy(&mutex); }
+
+    // the pooled copy of the name [begin,end)
+    public: const std::string *intern(const char *begin, const char *end) {
+        pthread_mutex_lock(&mutex);
+        key.assign(begin, end);
+        const std::string *s = &*names.insert(key).first;
+        pthread_mutex_unlock(&mutex);
+        return s;
+    }
+    public: inline const std::string *intern(const std::string &name) {
+        return intern(name.data(), name.data() + name.size());
+    }
+
+    // number of distinct names
+    public: size_t size() {
+        pthread_mutex_lock(&mutex);
+        const size_t n = names.size();
+        pthread_mutex_unlock(&mutex);
+        return n;
+    }
+};
+
+// names of the nodes of a tree: an array indexed by node of pointers to the names in the
+// pool shared by all trees, NULL for nodes without a name. it keeps the interface of the
+// map from node to name it replaced: find(), insert(), operator[] and iteration over the
+// (node, name) pairs, in node order; name() is the direct access without a copy
+class idx2name {
+    public: typedef unsigned int key_type;
+    public: typedef std::string mapped_type;
+    public: typedef std::pair<unsigned int, std::string> value_type;
+
+    protected: std::vector<const std::string*> ids;
+    protected: size_t count; // number of nodes with a name
+
+    // the pool of the names of all trees
+    public: static NamePool &pool() {
+        static NamePool names;
+        return names;
+    }
+
+    // (node, name) pairs of the named nodes, the pair is a copy made when it is dereferenced
+    public: class iterator : public std::iterator<std::forward_iterator_tag, value_type> {
+        protected: const idx2name *names;
+        protected: unsigned int v;
+        protected: mutable value_type current;
+        public: iterator(const idx2name *names_ = NULL, const unsigned int v_ = 0) : names(names_), v(v_) { skip(); }
+        public: inline bool operator==(const iterator &r) const { return v == r.v; }
+        public: inline bool operator!=(const iterator &r) const { return v != r.v; }
+        public: inline iterator& operator++() {
+            ++v;
+            skip();
+            return *this;
+        }
+        public: inline iterator operator++(int) {
+            iterator i = *this;
+            ++*this;
+            return i;
+        }
+        public: inline value_type& operator*() const {
+            current.first = v;
+            current.second = *names->ids[v];
+            return current;
+        }
+        public: inline value_type* operator->() const { return &**this; }
+        protected: inline void skip() {
+            if (names == NULL) return;
+            while ((v < names->ids.size()) && (names->ids[v] == NULL)) ++v;
+        }
+    };
+    public: typedef iterator const_iterator;
+
+    // name of a node that can be assigned to
+    public: class reference {
+        protected: idx2name &names;
+        protected: const unsigned int v;
+        public: reference(idx2name &names_, const unsigned int v_) : names(names_), v(v_) {}
+        public: inline operator const std::string&() const { return names.get(v); }
+        public: inline reference& operator=(const std::string &name) {
+            names.set(v, name);
+            return *this;
+        }
+    };
+
+    public: idx2name() : count(0) {}
+
+    // make room for the nodes [0,n)
+    public: inline void reserve(const size_t n) { ids.reserve(n); }
+
+    public: inline size_t size() const { return count; }
+    public: inline bool empty() const { return count == 0; }
+    // nodes [0,node_size()) can have a name
+    public: inline unsigned int node_size() const { return ids.size(); }
+    public: inline void clear() {
+        ids.clear();
+        count = 0;
+    }
+
+    // pooled name of node v, NULL if it has none
+    public: inline const std::string *name(const unsigned int v) const {
+        return v < ids.size() ? ids[v] : NULL;
+    }
+
+    // name of node v, empty if it has none
+    public: inline const std::string &get(const unsigned int v) const {
+        static const std::string none;
+        const std::string *s = name(v);
+        return s == NULL ? none : *s;
+    }
+
+    // give node v a name, the pooled one (from pool().intern()) or any other that is interned
+    public: inline void set(const unsigned int v, const std::string *pooled) {
+        if (v >= ids.size()) ids.resize(v + 1, NULL);
+        if (ids[v] == NULL) ++count;
+        ids[v] = pooled;
+    }
+    public: inline void set(const unsigned int v, const std::string &name) { set(v, pool().intern(name)); }
+
+    // like the map: the name is only set if the node has none
+    public: inline bool insert(const value_type &w) {
+        if (name(w.first) != NULL) return false;
+        set(w.first, w.second);
+        return true;
+    }
+
+    public: inline void erase(const unsigned int v) {
+        if (name(v) == NULL) return;
+        ids[v] = NULL;
+        --count;
+    }
+
+    public: inline reference operator[](const unsigned int v) { return reference(*this, v); }
+    public: inline const std::string &operator[](const unsigned int v) const { return get(v); }
+
+    public: inline iterator begin() const { return iterator(this, 0); }
+    public: inline iterator end() const { return iterator(NULL, ids.size()); }
+    public: inline iterator find(const unsigned int v) const { return name(v) == NULL ? end() : iterator(this, v); }
+};
 
 // stores one or more node/edge weights
 // example
@@ -52,11 +207,14 @@ class weights_type {
         if (i >= data.size()) data.resize(i+1);
         return data[i];
     }
+    public: inline const VALUE &operator[](const unsigned int i) const {
+        return data[i];
+    }
     public: inline weights_type& operator=(const VALUE r) {
         (*this)[0] = r;
         return *this;
     }
-    public: inline size_t size() {
+    public: inline size_t size() const {
         return data.size();
     }
     // required function for tree_IO
@@ -64,24 +222,182 @@ class weights_type {
         data.push_back(v);
     }
     // required function for tree_IO
-    public: inline void display_in_newick(std::ostream &os) {
+    public: inline void display_in_newick(std::ostream &os) const {
         BOOST_FOREACH(const VALUE &v, data) {
             os << ':' << v;
             // os << ':' << fixed << setprecision(20) << v;
         }
     }
 };
-// map from node_id to weight(s)
+
+// weight(s) of the nodes of a tree, structure of arrays indexed by node: the first weight
+// of every node in one contiguous array (VALUE() for nodes without weights), the number of
+// weights of every node and the rare weights after the first one in a map
+// it keeps the interface of the map from node to weights_type it replaced: operator[]
+// (creates the weights of a node, like the map), find(), iteration over the (node, weights)
+// pairs in node order; first() and array() are the direct access to the branch lengths
 // VALUE is the data type precision of the weight
 template<class VALUE>
-class idx2weight_type
-#ifdef NOHASH
-: public std::map<unsigned int,weights_type<VALUE> >
-#else
-: public boost::unordered_map<unsigned int,weights_type<VALUE> >
-#endif
-{
+class idx2weight_type {
+    public: typedef unsigned int key_type;
     public: typedef weights_type<VALUE> data_type;
+    public: typedef weights_type<VALUE> mapped_type;
+    public: typedef std::pair<unsigned int, data_type> value_type;
+
+    protected: enum { NONE = 0, ONE = 1, MORE = 2 };
+    protected: std::vector<VALUE> first_;                         // first weight of every node
+    protected: std::vector<unsigned char> count_;                 // NONE, ONE or MORE weights
+    protected: std::map<unsigned int, std::vector<VALUE> > more_; // the weights after the first
+    protected: size_t size_;                                      // number of nodes with weights
+
+    // (node, weights) pairs of the nodes with weights, the pair is a copy made when it is dereferenced
+    public: class iterator : public std::iterator<std::forward_iterator_tag, value_type> {
+        protected: const idx2weight_type *weights;
+        protected: unsigned int v;
+        protected: mutable value_type current;
+        public: iterator(const idx2weight_type *weights_ = NULL, const unsigned int v_ = 0) : weights(weights_), v(v_) { skip(); }
+        public: inline bool operator==(const iterator &r) const { return v == r.v; }
+        public: inline bool operator!=(const iterator &r) const { return v != r.v; }
+        public: inline iterator& operator++() {
+            ++v;
+            skip();
+            return *this;
+        }
+        public: inline iterator operator++(int) {
+            iterator i = *this;
+            ++*this;
+            return i;
+        }
+        public: inline value_type& operator*() const {
+            current.first = v;
+            current.second = weights->get(v);
+            return current;
+        }
+        public: inline value_type* operator->() const { return &**this; }
+        protected: inline void skip() {
+            if (weights == NULL) return;
+            while ((v < weights->count_.size()) && (weights->count_[v] == NONE)) ++v;
+        }
+    };
+    public: typedef iterator const_iterator;
+
+    // weights of a node that can be changed, like weights_type
+    public: class reference {
+        protected: idx2weight_type &weights;
+        protected: const unsigned int v;
+        public: reference(idx2weight_type &weights_, const unsigned int v_) : weights(weights_), v(v_) {}
+        public: inline VALUE &operator[](const unsigned int i) { return weights.at(v, i); }
+        public: inline const VALUE &operator[](const unsigned int i) const { return weights.at(v, i); }
+        public: inline reference& operator=(const VALUE r) {
+            weights.at(v, 0) = r;
+            return *this;
+        }
+        public: inline size_t size() const { return weights.size_of(v); }
+        public: inline void push_back(const VALUE w) { weights.at(v, size()) = w; }
+        public: inline void display_in_newick(std::ostream &os) const {
+            for (unsigned int i=0,iEE=size(); i<iEE; ++i) os << ':' << (*this)[i];
+        }
+    };
+
+    public: idx2weight_type() : size_(0) {}
+
+    // make room for the nodes [0,n)
+    public: inline void reserve(const size_t n) {
+        first_.reserve(n);
+        count_.reserve(n);
+    }
+
+    public: inline size_t size() const { return size_; }
+    public: inline bool empty() const { return size_ == 0; }
+    // nodes [0,node_size()) can have weights
+    public: inline unsigned int node_size() const { return count_.size(); }
+    public: inline void clear() {
+        first_.clear();
+        count_.clear();
+        more_.clear();
+        size_ = 0;
+    }
+
+    // number of weights of node v
+    public: inline size_t size_of(const unsigned int v) const {
+        if (v >= count_.size()) return 0;
+        if (count_[v] != MORE) return count_[v];
+        return 1 + more_.find(v)->second.size();
+    }
+
+    // first weight of node v, VALUE() if it has none
+    public: inline VALUE first(const unsigned int v) const {
+        return v < first_.size() ? first_[v] : VALUE();
+    }
+
+    // the first weights of the nodes [0,node_size()), VALUE() for nodes without weights
+    public: inline const std::vector<VALUE> &array() const { return first_; }
+
+    // sum of the first weights
+    public: inline VALUE total() const {
+        VALUE sum = VALUE();
+        for (unsigned int v=0,vEE=first_.size(); v<vEE; ++v) sum += first_[v];
+        return sum;
+    }
+
+    // nodes [0,n) without weights get one of VALUE(), like reading weights[v][0] of each
+    public: void fill(const unsigned int n) {
+        if (n > count_.size()) grow(n - 1);
+        for (unsigned int v=0; v<n; ++v) if (count_[v] == NONE) {
+            count_[v] = ONE;
+            ++size_;
+        }
+    }
+
+    // copy of the weights of node v, empty if it has none
+    public: data_type get(const unsigned int v) const {
+        data_type w;
+        const size_t n = size_of(v);
+        if (n == 0) return w;
+        w.push_back(first_[v]);
+        if (n > 1) {
+            BOOST_FOREACH(const VALUE &x, more_.find(v)->second) w.push_back(x);
+        }
+        return w;
+    }
+
+    // weight i of node v, the weights [0,i] of the node are created as needed (not for NONODE)
+    public: inline VALUE &at(const unsigned int v, const unsigned int i) {
+        if (v >= count_.size()) grow(v);
+        if (count_[v] == NONE) {
+            count_[v] = ONE;
+            ++size_;
+        }
+        if (i == 0) return first_[v];
+        std::vector<VALUE> &more = more_[v];
+        count_[v] = MORE;
+        if (i > more.size()) more.resize(i);
+        return more[i - 1];
+    }
+    public: inline const VALUE &at(const unsigned int v, const unsigned int i) const {
+        return i == 0 ? first_[v] : more_.find(v)->second[i - 1];
+    }
+
+    public: inline void erase(const unsigned int v) {
+        if (size_of(v) == 0) return;
+        if (count_[v] == MORE) more_.erase(v);
+        count_[v] = NONE;
+        first_[v] = VALUE();
+        --size_;
+    }
+
+    public: inline reference operator[](const unsigned int v) { return reference(*this, v); }
+
+    public: inline iterator begin() const { return iterator(this, 0); }
+    public: inline iterator end() const { return iterator(NULL, count_.size()); }
+    public: inline iterator find(const unsigned int v) const { return size_of(v) == 0 ? end() : iterator(this, v); }
+
+    // NONODE is refused, its index would wrap the size around to 0
+    protected: inline void grow(const unsigned int v) {
+        if (v == NONODE) ERROR_exit("weight of no node");
+        first_.resize(v + 1, VALUE());
+        count_.resize(v + 1, NONE);
+    }
 };
 
 // statndard weight data type is double
@@ -124,6 +440,7 @@ bool stream2tree(std::istream &is, TREE &tree, idx2name &names, WEIGHTS &weights
         if (c == ':') { // sibling
             std::string w_str = input.getName();
             if (w_str.empty()) ERROR_return("cannot read weight/branch length value " << input.getLastPos());
+            if (lin == UINT_MAX) ERROR_return("branch length without a node " << input.getLastPos());
             typename WEIGHTS::data_type::value_type w;
             if (util::convert(w_str,w)) weights[lin].push_back(w);
             else ERROR_return("cannot read weight/branch length value " << input.getLastPos());
@@ -161,6 +478,153 @@ inline bool stream2tree(std::istream &is, TREE &tree) {
     return stream2tree(is, tree, names);
 }
 
+// next character of a newick text that is neither a whitespace nor in a [comment], end if there is none
+inline const char *newick_next(const char *p, const char * const end) {
+    for (;;) {
+        while ((p != end) && ((*p==' ') || (*p=='\t') || (*p=='\n') || (*p=='\r') || (*p=='\f'))) ++p;
+        if ((p == end) || (*p != '[')) return p;
+        p = static_cast<const char*>(memchr(p, ']', end - p));
+        if (p == NULL) return end;
+        ++p;
+    }
+}
+
+// a name or weight starting at p: 'quoted' or "quoted", or the longest run of legal name characters
+// [begin,end) is the name, p is moved after it
+inline void newick_name(const char *&p, const char * const end, const char *&begin, const char *&name_end) {
+    if ((*p == '\'') || (*p == '"')) {
+        begin = ++p;
+        while ((p != end) && (*p != '\'') && (*p != '"')) ++p;
+        name_end = p;
+        if (p != end) ++p;
+    } else {
+        begin = p;
+        for (; p != end; ++p) {
+            const char c = *p;
+            if (!legalChar4Name(c)) break;
+        }
+        name_end = p;
+    }
+}
+
+// "line l column c" of p in text
+inline std::string newick_position(const char *text, const char *p) {
+    std::ostringstream os;
+    unsigned int line = 1;
+    const char *line_begin = text;
+    for (const char *q = text; q != p; ++q) if (*q == '\n') {
+        ++line;
+        line_begin = q + 1;
+    }
+    os << "line " << line << " column " << p - line_begin + 1;
+    return os.str();
+}
+
+// end of the newick tree starting at p: after its ';', or end if there is none
+// ';' in comments and quoted names do not count
+inline const char *newick_tree_end(const char *p, const char * const end) {
+    while (p != end) {
+        const char c = *p++;
+        if (c == ';') return p;
+        if (c == '[') {
+            p = static_cast<const char*>(memchr(p, ']', end - p));
+            if (p == NULL) return end;
+            ++p;
+        } else
+        if ((c == '\'') || (c == '"')) {
+            while ((p != end) && (*p != '\'') && (*p != '"')) ++p;
+            if (p != end) ++p;
+        }
+    }
+    return end;
+}
+
+// read the tree from the newick text [p,end) in one pass over the bytes, p is moved after the ';'
+// gives the same tree, names and weights as stream2tree on a stream of the text without copying
+// the text char by char; used for whole files mapped into memory
+template<class TREE, class WEIGHTS>
+bool text2tree(const char *&p, const char * const end, TREE &tree, idx2name &names, WEIGHTS &weights) {
+    const unsigned int default_root = tree.node_size();
+    const char * const text = p;
+    while ((p != end) && ((*p==' ') || (*p=='\t') || (*p=='\n') || (*p=='\r') || (*p=='\f'))) ++p;
+    std::string rooting; // a leading comment is kept, [&U] makes the tree unrooted
+    if ((p != end) && (*p == '[')) {
+        const char *close = static_cast<const char*>(memchr(p, ']', end - p));
+        if (close == NULL) close = end;
+        rooting.assign(p, close);
+        rooting += ']';
+        p = (close == end) ? end : close + 1;
+    }
+    { // every '(' and ',' starts at most one node
+        const char *semicolon = static_cast<const char*>(memchr(p, ';', end - p));
+        if (semicolon == NULL) semicolon = end;
+        const size_t commas = std::count(p, semicolon, ','), nodes = std::count(p, semicolon, '(') + commas + 1;
+        tree.node_reserve(tree.node_size() + nodes);
+        names.reserve(tree.node_size() + nodes);
+        weights.reserve(tree.node_size() + nodes);
+    }
+    std::vector<unsigned int> parents;
+    unsigned int lin = UINT_MAX; // Last Internal Node
+    const char *begin, *name_end;
+    for (;;) {
+        p = newick_next(p, end);
+        if (p == end) return false;
+        const char c = *p;
+        if (c == ';') {
+            ++p;
+            if (!parents.empty()) ERROR_return("problem in the tree expression " << newick_position(text, p - 1));
+            break;
+        } else
+        if (c == '(') { // new subtree
+            const unsigned int subtree_root = tree.new_node();
+            if (!parents.empty()) { // add an edge to the parent unless it is the root node
+                tree.add_edge(parents.back(), subtree_root);
+            }
+            parents.push_back(subtree_root);
+            ++p;
+        } else
+        if (c == ',') { // sibling
+            lin = UINT_MAX;
+            ++p;
+        } else
+        if (c == ')') { // subtree completed
+            if (parents.empty()) ERROR_return("problem in the tree expression " << newick_position(text, p));
+            lin = parents.back();
+            parents.pop_back();
+            ++p;
+        } else
+        if (c == ':') { // weight
+            p = newick_next(p + 1, end);
+            if (p == end) ERROR_return("cannot read weight/branch length value " << newick_position(text, p));
+            if (lin == UINT_MAX) ERROR_return("branch length without a node " << newick_position(text, p));
+            newick_name(p, end, begin, name_end);
+            typename WEIGHTS::data_type::value_type w;
+            if ((begin != name_end) && util::convert(begin, name_end, w)) weights[lin].push_back(w);
+            else ERROR_return("cannot read weight/branch length value " << newick_position(text, p));
+        } else { // name
+            if (lin == UINT_MAX) { // name for a leaf or internal node?
+                lin = tree.new_node();
+                if (!parents.empty()) { // parents can be empty when the tree is only 1 node "i.e. [&R] species;"
+                    tree.add_edge(parents.back(), lin);
+                }
+            }
+            newick_name(p, end, begin, name_end);
+            if (begin == name_end) ERROR_return("problem in the tree expression " << newick_position(text, p));
+            if (names.name(lin) == NULL) names.set(lin, idx2name::pool().intern(begin, name_end));
+        }
+    }
+    if (rooting.compare("[&U]")==0) tree.unroot();
+    else
+    if (tree.empty()) tree.unroot();
+    else tree.root = default_root;
+    return true;
+}
+template<class TREE, class WEIGHTS>
+inline bool text2tree(const std::string &text, TREE &tree, idx2name &names, WEIGHTS &weights) {
+    const char *p = text.data();
+    return text2tree(p, p + text.size(), tree, names, weights);
+}
+
 enum tree_format{ROOTED,UNROOTED};
 
 //             { // print weight
@@ -175,7 +639,7 @@ bool tree2newick(std::ostream &os, TREE &tree, idx2name &names, WEIGHTS &weights
     if (flag == UNROOTED) os << "[&U]";
     const unsigned int save_root = tree.root;
     tree.root = root;
-    TREE_DFS2(v,tree) {
+    TREE_DFS_T(v, typename TREE, tree) {
         if (!tree.is_leaf(v.idx)) {
             if (v.direction == PREORDER) os << '(';
             if (v.direction == INORDER) os << ',';
@@ -183,8 +647,8 @@ bool tree2newick(std::ostream &os, TREE &tree, idx2name &names, WEIGHTS &weights
         }
         if (v.direction == POSTORDER) {
             { // print name
-                idx2name::iterator itr = names.find(v.idx);
-                if (itr != names.end()) os << NS_input::getlegalstring(itr->second);
+                const std::string *name = names.name(v.idx);
+                if (name != NULL) os << NS_input::getlegalstring(*name);
             }
             { // print weight(s)
                 typename WEIGHTS::iterator itr = weights.find(v.idx);
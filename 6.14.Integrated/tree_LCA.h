@@ -20,6 +20,7 @@ namespace RMQ {
 }
 #include "tree_traversal.h"
 #include <vector>
+#include <algorithm>
 #include <iostream>
 
 namespace aw {
@@ -27,76 +28,103 @@ namespace aw {
 using namespace std;
 
 // preprocess the LCA computation (build RMQ)
+// the INORDER steps of the tree are the RMQ sequence: E holds their nodes, L their levels
+// and R the position of the first step of every node
 class LCA {
-    protected: RMQ::INT *R; // first occurences in sequence
-    protected: RMQ::VAL *E, *L; // sequence - E:nodes, L:levels
-    protected: struct RMQ::rmqinfo *ri; // lookup table
-    protected: unsigned int R_size, E_size, L_size;
+    protected: vector<RMQ::VAL> E, L; // sequence - E:nodes, L:levels
+    protected: vector<RMQ::INT> R; // first occurences in sequence
+    protected: struct RMQ::rmqinfo *ri; // lookup table over L
 
-    public: LCA() {
-        init();
-    }
-    public: LCA(const LCA &r) { // copy constructor
-        init();
-        copy(r);
+    public: LCA() : ri(NULL) {}
+    public: LCA(const LCA &r) : E(r.E), L(r.L), R(r.R), ri(NULL) { // copy constructor
+        preprocess();
     }
     public: LCA& operator=(const LCA& r) { // assign operator
         if (this != &r) {
             free();
-            copy(r);
+            E = r.E; L = r.L; R = r.R;
+            preprocess();
         }
         return *this;
     }
-    protected: inline void init() {
-        R = NULL; E = NULL; L = NULL; ri = NULL;
-        R_size = E_size = L_size = 0;
-    }
-    protected: inline void copy(const LCA &r) {
-        if (r.E_size != 0) {E_size = r.E_size; E = new RMQ::VAL[E_size]; memcpy(E, r.E, E_size * sizeof(RMQ::VAL));}
-        if (r.L_size != 0) {L_size = r.L_size; L = new RMQ::VAL[L_size]; memcpy(L, r.L, L_size * sizeof(RMQ::VAL));}
-        if (r.R_size != 0) {R_size = r.R_size; R = new RMQ::INT[R_size]; memcpy(R, r.R, R_size * sizeof(RMQ::INT));}
-        if (r.L_size != 0) {ri = RMQ::rm_query_preprocess(L, L_size);}
-    }
     public: ~LCA() { this->free(); }
     protected: inline void free() {
-        if (R != NULL) delete [] R;
-        if (E != NULL) delete [] E;
-        if (L != NULL) delete [] L;
         if (ri != NULL) rm_free(ri);
-        init();
+        ri = NULL;
+    }
+    // the lookup table points into L, so it is rebuilt whenever L is
+    protected: inline void preprocess() {
+        if (!L.empty()) ri = RMQ::rm_query_preprocess(&L[0], L.size());
     }
 
+    // one DFS over the tree fills E, L and R
     public: template<class TREE> inline bool create(TREE &tree) {
         free();
-        vector<unsigned int> seq, lvl; seq.reserve(tree.node_size()); lvl.reserve(tree.node_size());
-        TREE_INORDER2(v, tree) {
-            seq.push_back(v.idx);
-            lvl.push_back(v.lvl);
+        const unsigned int n = tree.node_size();
+        E.clear(); E.reserve(n);
+        L.clear(); L.reserve(n);
+        R.assign(n, NONODE);
+        for (typename TREE::iterator_inorder v=tree.begin_inorder(),vEE=tree.end_inorder(); v!=vEE; ++v) {
+            if (R[v.idx] == NONODE) R[v.idx] = E.size();
+            E.push_back(v.idx);
+            L.push_back(v.lvl);
         }
-        const unsigned int n = seq.size();
-        E_size = n; E = new RMQ::VAL[E_size]; for (unsigned int i=0;i<n;i++) E[i] = seq[i];
-        L_size = n; L = new RMQ::VAL[L_size]; for (unsigned int i=0;i<n;i++) L[i] = lvl[i];
-        R_size = tree.node_size(); R = new RMQ::INT[R_size]; for (unsigned int i=n; i>0; i--) R[E[i-1]] = i-1;
-        ri = RMQ::rm_query_preprocess(L, n);
+        preprocess();
         return true;
     }
-    public: inline unsigned int lca(const unsigned int u, const unsigned int v) {
+
+    // position of the first step of node v in the sequence
+    // the nodes of a subtree have consecutive positions
+    public: inline unsigned int position(const unsigned int v) const { return R[v]; }
+
+    // lca of the nodes at the positions x and y
+    public: inline unsigned int lca_at(const unsigned int x, const unsigned int y) const {
+        return E[rm_query(ri, x, y)];
+    }
+
+    public: inline unsigned int lca(const unsigned int u, const unsigned int v) const {
         if (u == v) return u;
         if (u == NONODE) return v;
         if (v == NONODE) return u;
-        const RMQ::INT uidx = R[u];
-        const RMQ::INT vidx = R[v];
-        return E[rm_query(ri, uidx, vidx)];
+        return lca_at(R[u], R[v]);
+    }
+
+    // lca of a set of nodes, which is the lca of its first and last node in the sequence
+    // NONODE elements are ignored, 0 if there is no other node
+    public: template<class T> unsigned int lca(T nodes) const {
+        unsigned int lo = NONODE, hi = 0;
+        BOOST_FOREACH(const unsigned int &v, nodes) {
+            if (v == NONODE) continue;
+            if (R[v] < lo) lo = R[v];
+            if (R[v] > hi) hi = R[v];
+        }
+        return lo == NONODE ? 0 : lca_at(lo, hi);
     }
-    public: template<class T> unsigned int lca(T leaves) {
-        unsigned int r = 0;
-        bool first = true;
-        BOOST_FOREACH(const unsigned int &v, leaves) if (first) { r = v; first=false; } else r = lca(r,v);
-        return r;
+
+    // lcas[i] = lca(pairs[i].first, pairs[i].second) for many pairs at once
+    // the queries are answered in the order of their positions, so consecutive ones read
+    // neighbouring parts of the lookup table instead of jumping around the tree
+    public: void lca(const vector<pair<unsigned int, unsigned int> > &pairs, vector<unsigned int> &lcas) const {
+        const unsigned int n = pairs.size();
+        lcas.resize(n);
+        vector<pair<RMQ::INT, unsigned int> > order; // (first position, query)
+        order.reserve(n);
+        for (unsigned int i=0; i<n; ++i) {
+            const unsigned int u = pairs[i].first, v = pairs[i].second;
+            if ((u == v) || (v == NONODE)) lcas[i] = u;
+            else if (u == NONODE) lcas[i] = v;
+            else order.push_back(make_pair(min(R[u], R[v]), i));
+        }
+        sort(order.begin(), order.end());
+        for (unsigned int i=0,iEE=order.size(); i<iEE; ++i) {
+            const pair<unsigned int, unsigned int> &q = pairs[order[i].second];
+            lcas[order[i].second] = lca_at(R[q.first], R[q.second]);
+        }
     }
 
     public: void clear() {
         free();
+        E.clear(); L.clear(); R.clear();
     }
 };
 
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2011 Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TREE_LCA_DYNAMIC_H
+#define TREE_LCA_DYNAMIC_H
+
+#include "common.h"
+#include "tree.h"
+#include "tree_traversal.h"
+#include "touched.h"
+#include <vector>
+#include <algorithm>
+
+namespace aw {
+
+using namespace std;
+
+// LCA queries on a rooted tree that grows by subdividing edges and attaching leaves
+// drop-in for LCA::lca() when the tree changes between queries
+// link-cut tree: the tree is split into paths, every path is a splay tree ordered by depth,
+// the parent pointer of the root of a splay tree points to the parent of the top of its path
+// O(n) precomputation
+// O(log n) amortized per query and update
+// O(changes) restore of a copy to its original
+class DynamicLCA {
+    protected: vector<unsigned int> lc, rc, up; // splay trees and path parents
+    protected: util::TouchedSet touched;        // nodes changed since create() or restore(), queries change nodes too
+
+    public: template<class TREE> inline bool create(TREE &tree, const unsigned int capacity = 0) {
+        const unsigned int n = std::max(capacity, tree.node_size());
+        lc.assign(n, NONODE);
+        rc.assign(n, NONODE);
+        up.assign(n, NONODE);
+        touched.create(n);
+        // every node starts as a path of its own
+        TREE_POSTORDER_T(v, typename TREE, tree) up[v.idx] = v.parent;
+        return true;
+    }
+
+    public: inline unsigned int lca(const unsigned int u, const unsigned int v) {
+        if (u == v) return u;
+        if (u == NONODE) return v;
+        if (v == NONODE) return u;
+        access(u);
+        return access(v);
+    }
+    public: template<class T> unsigned int lca(T leaves) {
+        unsigned int r = 0;
+        bool first = true;
+        BOOST_FOREACH(const unsigned int &v, leaves) if (first) { r = v; first=false; } else r = lca(r,v);
+        return r;
+    }
+
+    // insert the new node x into the edge from v to its parent
+    public: inline void subdivide_edge(const unsigned int v, const unsigned int x) {
+        reserve(x);
+        access(v);
+        // the ancestors of v are the left subtree of v, x becomes the predecessor of v
+        lc[x] = lc[v];
+        if (lc[x] != NONODE) { up[lc[x]] = x; touched.touch(lc[x]); }
+        rc[x] = NONODE;
+        lc[v] = x;
+        up[x] = v;
+        touched.touch(x);
+        touched.touch(v);
+    }
+
+    // attach the new leaf l to node p
+    public: inline void insert_leaf(const unsigned int p, const unsigned int l) {
+        reserve(l);
+        lc[l] = rc[l] = NONODE;
+        up[l] = p;
+        touched.touch(l);
+    }
+
+    // the edge of selected gets subdivided by the new node i_n which also gets the new leaf l_n as a child
+    public: inline void graft(const unsigned int selected, const unsigned int i_n, const unsigned int l_n) {
+        subdivide_edge(selected, i_n);
+        insert_leaf(i_n, l_n);
+    }
+
+    // undo all changes since this structure was copied from base; base must be that original
+    public: inline void restore(const DynamicLCA &base) {
+        const unsigned int n = base.up.size();
+        for (unsigned int k=0,kEE=touched.size(); k<kEE; ++k) {
+            const unsigned int v = touched[k];
+            lc[v] = v < n ? base.lc[v] : NONODE;
+            rc[v] = v < n ? base.rc[v] : NONODE;
+            up[v] = v < n ? base.up[v] : NONODE;
+        }
+        touched.clear();
+    }
+
+    public: void clear() {
+        lc.clear();
+        rc.clear();
+        up.clear();
+        touched.create(0);
+    }
+
+    protected: inline void reserve(const unsigned int x) {
+        if (x < up.size()) return;
+        const unsigned int n = std::max(x + 1, (unsigned int)(2 * up.size()));
+        lc.resize(n, NONODE);
+        rc.resize(n, NONODE);
+        up.resize(n, NONODE);
+        touched.resize(n);
+    }
+
+    protected: inline bool is_splay_root(const unsigned int x) const {
+        const unsigned int p = up[x];
+        return (p == NONODE) || ((lc[p] != x) && (rc[p] != x));
+    }
+    protected: inline void rotate(const unsigned int x) {
+        const unsigned int p = up[x];
+        const unsigned int g = up[p];
+        if (!is_splay_root(p)) {
+            if (lc[g] == p) lc[g] = x; else rc[g] = x;
+            touched.touch(g);
+        }
+        if (lc[p] == x) {
+            lc[p] = rc[x];
+            if (rc[x] != NONODE) { up[rc[x]] = p; touched.touch(rc[x]); }
+            rc[x] = p;
+        } else {
+            rc[p] = lc[x];
+            if (lc[x] != NONODE) { up[lc[x]] = p; touched.touch(lc[x]); }
+            lc[x] = p;
+        }
+        up[p] = x;
+        up[x] = g;
+        touched.touch(p);
+        touched.touch(x);
+    }
+    protected: inline void splay(const unsigned int x) {
+        while (!is_splay_root(x)) {
+            const unsigned int p = up[x];
+            if (!is_splay_root(p)) {
+                const unsigned int g = up[p];
+                rotate(((lc[g] == p) == (lc[p] == x)) ? p : x);
+            }
+            rotate(x);
+        }
+    }
+    // make the path from the root to x preferred, x becomes the root of its splay tree;
+    // returns the last path joined, which is the LCA of x and the node accessed before
+    protected: inline unsigned int access(const unsigned int x) {
+        unsigned int last = NONODE;
+        for (unsigned int y=x; y!=NONODE; y=up[y]) {
+            splay(y);
+            rc[y] = last;
+            touched.touch(y);
+            last = y;
+        }
+        splay(x);
+        return last;
+    }
+};
+
+} // namespace end
+
+#endif
@@ -0,0 +1,627 @@
+/*
+ * Copyright (C) 2011 Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+// rooted tree, mostly binary
+
+#ifndef TREE_BINARY_H
+#define TREE_BINARY_H
+
+#include "common.h"
+#include "tree.h"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <math.h>
+
+namespace aw {
+
+using namespace std;
+
+// rooted tree whose nodes have a parent and mostly 2 children: the parent and the first 2
+// children of every node are kept inline in flat arrays indexed by node, so a node needs no
+// allocation of its own and parent() is O(1); the children after the second one (polytomies,
+// like the root of "(a,b,c);") are kept in a map
+// it has the interface of TreeTemplate: new_node(), add_edge(), remove_edge(), adjacent()
+// and children() (as views instead of containers) and the same traversal iterators
+// add_edge(v,u) makes u a child of v; the adjacent nodes of a node are its parent followed
+// by its children in the order they were added, the order of a TreeTemplate built the same way
+template<class VALUE>
+class BinaryTreeTemplate {
+    // some data type definitions
+    public: typedef VALUE value_type;
+    protected: typedef BinaryTreeTemplate<value_type> this_type;
+
+    protected: vector<unsigned int> up;                            // parent of every node, NONODE for none
+    protected: vector<unsigned int> down;                          // first 2 children of node v at 2v and 2v+1, NONODE for none
+    protected: std::map<unsigned int, vector<unsigned int> > more; // the children after the first 2
+    protected: vector<value_type> values;
+
+    // define a special value for unrooted trees
+    public: unsigned int root;
+
+    // keeps track of number of edges
+    protected: unsigned int edge_count;
+
+    // traversal orders, see preorder()
+    protected: TraversalOrders orders_;
+
+    // list of nodes adjacent to a node, a view into the tree
+    // iteratable by std::forward_iterator
+    public: class AdjacentList {
+        protected: const this_type *tree;
+        protected: unsigned int v;
+        public: AdjacentList(const this_type *tree_, const unsigned int v_) : tree(tree_), v(v_) {}
+        public: inline unsigned int size() const { return tree->degree(v); }
+        // the i-th adjacent node
+        public: inline unsigned int operator[](const unsigned int i) const { return tree->adjacent_at(v, i); }
+        // true if node is adjacent
+        public: inline bool exist(const unsigned int u) const {
+            if (u == NONODE) return false;
+            return (tree->parent(u) == v) || (tree->parent(v) == u);
+        }
+        public: class Iterator : public std::iterator<std::forward_iterator_tag, unsigned int, ptrdiff_t, const unsigned int*, unsigned int> {
+            public: Iterator(const AdjacentList *list_, const unsigned int i_) : list(list_), i(i_) {}
+            public: inline bool operator==(const Iterator &r) const { return i == r.i; }
+            public: inline bool operator!=(const Iterator &r) const { return i != r.i; }
+            public: inline Iterator& operator++() {
+                ++i;
+                return *this;
+            }
+            public: inline Iterator operator++(int) {
+                Iterator tmp(*this);
+                ++(*this);
+                return tmp;
+            }
+            public: inline unsigned int operator*() const { return (*list)[i]; }
+            protected: const AdjacentList *list;
+            protected: unsigned int i;
+        };
+        // default iterator is Iterator (std::forward_iterator)
+        public: typedef Iterator iterator;
+        public: typedef Iterator const_iterator;
+        public: inline Iterator begin() const { return Iterator(this, 0); }
+        public: inline Iterator end() const { return Iterator(this, size()); }
+    };
+
+    // list of the nodes adjacent to a node except one (its parent in a traversal), a view into the tree
+    // iteratable by std::forward_iterator
+    public: class ChildrenList {
+        protected: const this_type *tree;
+        protected: unsigned int v, parent;
+        public: ChildrenList(const this_type *tree_, const unsigned int v_, const unsigned int parent_) : tree(tree_), v(v_), parent(parent_) {}
+        public: inline unsigned int size() const {
+            const unsigned int d = tree->degree(v);
+            return exist_adjacent(parent) ? d - 1 : d;
+        }
+        // true if node is a child
+        public: inline bool exist(const unsigned int u) const {
+            if (u == parent) return false;
+            return exist_adjacent(u);
+        }
+        protected: inline bool exist_adjacent(const unsigned int u) const {
+            if (u == NONODE) return false;
+            return (tree->parent(u) == v) || (tree->parent(v) == u);
+        }
+        public: class Iterator : public std::iterator<std::forward_iterator_tag, unsigned int, ptrdiff_t, const unsigned int*, unsigned int> {
+            public: Iterator(const ChildrenList *list_, const unsigned int i_) : list(list_), i(i_) { skip(); }
+            public: inline bool operator==(const Iterator &r) const { return i == r.i; }
+            public: inline bool operator!=(const Iterator &r) const { return i != r.i; }
+            public: inline Iterator& operator++() {
+                ++i;
+                skip();
+                return *this;
+            }
+            public: inline Iterator operator++(int) {
+                Iterator tmp(*this);
+                ++(*this);
+                return tmp;
+            }
+            public: inline unsigned int operator*() const { return list->tree->adjacent_at(list->v, i); }
+            protected: inline void skip() {
+                if ((i < list->tree->degree(list->v)) && (**this == list->parent)) ++i;
+            }
+            protected: const ChildrenList *list;
+            protected: unsigned int i;
+        };
+        // default iterator is Iterator (std::forward_iterator)
+        public: typedef Iterator iterator;
+        public: typedef Iterator const_iterator;
+        public: inline Iterator begin() const { return Iterator(this, 0); }
+        public: inline Iterator end() const { return Iterator(this, tree->degree(v)); }
+    };
+
+    // default constructor
+    public: BinaryTreeTemplate() {
+        clear();
+    }
+
+    public: void clear() {
+        root = NONODE;
+        edge_count = 0;
+        up.clear();
+        down.clear();
+        more.clear();
+        values.clear();
+        orders_.invalidate();
+    }
+
+    // reserve memory for nodes being added in the future
+    public: void node_reserve(const unsigned int s) {
+        up.reserve(s);
+        down.reserve(2 * s);
+        values.reserve(s);
+    }
+
+    // access node
+    public: inline value_type& value(const unsigned int v) { return values[v]; }
+
+    // swap the content of 2 trees
+    public: void swap(this_type &r) {
+        up.swap(r.up);
+        down.swap(r.down);
+        more.swap(r.more);
+        values.swap(r.values);
+        util::swap(root, r.root);
+        util::swap(edge_count, r.edge_count);
+        orders_.invalidate();
+        r.orders_.invalidate();
+    }
+
+    // true if the tree contains no nodes (and no edges)
+    public: inline bool empty() const { return up.empty(); }
+
+    // parent of node v, NONODE for the root and nodes that are not connected
+    public: inline unsigned int parent(const unsigned int v) const { return up[v]; }
+
+    // number of children of node v
+    public: inline unsigned int children_size(const unsigned int v) const {
+        if (down[2*v+1] == NONODE) return down[2*v] == NONODE ? 0 : 1;
+        if (more.empty()) return 2;
+        typename std::map<unsigned int, vector<unsigned int> >::const_iterator itr = more.find(v);
+        return itr == more.end() ? 2 : 2 + itr->second.size();
+    }
+
+    // the i-th child of node v
+    public: inline unsigned int child(const unsigned int v, const unsigned int i) const {
+        return i < 2 ? down[2*v+i] : more.find(v)->second[i-2];
+    }
+
+    // position of the child c among the children of node v
+    public: inline unsigned int child_position(const unsigned int v, const unsigned int c) const {
+        if (down[2*v] == c) return 0;
+        if (down[2*v+1] == c) return 1;
+        const vector<unsigned int> &m = more.find(v)->second;
+        return 2 + (std::find(m.begin(), m.end(), c) - m.begin());
+    }
+
+    // the i-th adjacent node of v: the parent first, if there is one, then the children
+    public: inline unsigned int adjacent_at(const unsigned int v, const unsigned int i) const {
+        if (up[v] == NONODE) return child(v, i);
+        return i == 0 ? up[v] : child(v, i - 1);
+    }
+
+    // adjacent nodes in form of an iteratable container
+    public: inline AdjacentList adjacent(const unsigned int v) const { return AdjacentList(this, v); }
+
+    // adjacent nodes in a vector
+    public: inline void adjacent(const unsigned int v, std::vector<unsigned int> &vec) const {
+        const unsigned int d = degree(v);
+        vec.resize(d);
+        for (unsigned int i=0; i<d; ++i) vec[i] = adjacent_at(v, i);
+    }
+    public: inline std::vector<unsigned int> adjacent_vector(const unsigned int v) const {
+        std::vector<unsigned int> vec;
+        adjacent(v,vec);
+        return vec;
+    }
+
+    // child nodes in form of an iteratable container
+    public: inline ChildrenList children(const unsigned int v, const unsigned int parent) const {
+        return ChildrenList(this, v, parent);
+    }
+
+    // child nodes in a vector (explicit defined parent required)
+    public: inline void children(const unsigned int v, const unsigned int parent, std::vector<unsigned int> &vec) const {
+        vec.reserve(degree(v)-1);
+        for (unsigned int i=0,iEE=degree(v); i<iEE; ++i) {
+            const unsigned int u = adjacent_at(v, i);
+            if (u != parent) vec.push_back(u);
+        }
+    }
+    public: inline std::vector<unsigned int> children_vector(const unsigned int v, const unsigned int parent) const {
+        std::vector<unsigned int> vec;
+        children(v, parent, vec);
+        return vec;
+    }
+
+    // degree of a node
+    public: inline unsigned int degree(const unsigned int v) const {
+        return (up[v] == NONODE ? 0 : 1) + children_size(v);
+    }
+
+    // true if the node is a leaf (including single nodes)
+    public: inline bool is_leaf(const unsigned int v) const { return degree(v) <= 1; }
+
+    // connect 2 nodes with an edge, u becomes a child of v
+    public: inline void add_edge(const unsigned int v, const unsigned int u) {
+        if (up[u] != NONODE) ERROR_exit("node " << u << " has a parent already");
+        up[u] = v;
+        if (down[2*v] == NONODE) down[2*v] = u;
+        else if (down[2*v+1] == NONODE) down[2*v+1] = u;
+        else more[v].push_back(u);
+        ++edge_count;
+        orders_.invalidate();
+    }
+
+    // remove an edge between 2 nodes, in either direction
+    // the last child of the parent takes the place of the removed one, like in TreeTemplate
+    // return false edge does not exist
+    public: inline bool remove_edge(const unsigned int v, const unsigned int u) {
+        if (up[u] == v) remove_child(v, u);
+        else if (up[v] == u) remove_child(u, v);
+        else return false;
+        --edge_count;
+        orders_.invalidate();
+        return true;
+    }
+
+    // number of edges int the tree
+    public: inline unsigned int edge_size() const { return edge_count; }
+    // number of nodes in the tree
+    public: inline unsigned int node_size() const { return up.size(); }
+
+    // create a new node and add it to the tree. the node is disconnected from the tree
+    public: inline unsigned int new_node() {
+        const unsigned int l = up.size();
+        up.push_back(NONODE);
+        down.push_back(NONODE);
+        down.push_back(NONODE);
+        values.push_back(value_type());
+        return l;
+    }
+
+    // the nodes in the order of the PREORDER and POSTORDER steps of the DFS from the root,
+    // like TreeTemplate::preorder()
+    public: inline const std::vector<unsigned int> &preorder() { return orders().preorder; }
+    public: inline const std::vector<unsigned int> &postorder() { return orders().postorder; }
+    protected: inline TraversalOrders &orders() {
+        if (!orders_.current(root)) orders_.create(*this);
+        return orders_;
+    }
+
+    // remove all edges from a node
+    // note: the node is not deleted
+    public: inline void disconnect_node(const unsigned int v) {
+        while (degree(v) != 0) remove_edge(v, adjacent_at(v, 0));
+    }
+
+    // true if the root is defined
+    public: inline bool is_rooted() const {
+        return root != NONODE;
+    }
+
+    // true if the root is NOT defined
+    public: inline bool is_unrooted() const {
+        return root == NONODE;
+    }
+
+    // undefine the root
+    public: inline void unroot() {
+        root = NONODE;
+    }
+
+    protected: inline void remove_child(const unsigned int v, const unsigned int u) {
+        const unsigned int n = children_size(v);
+        unsigned int i = 0;
+        while (child(v, i) != u) ++i;
+        const unsigned int last = child(v, n - 1);
+        if (n > 2) {
+            vector<unsigned int> &m = more[v];
+            m.pop_back();
+            if (m.empty()) more.erase(v);
+        } else down[2*v+n-1] = NONODE;
+        if (i != n - 1) {
+            if (i < 2) down[2*v+i] = last;
+            else more[v][i-2] = last;
+        }
+        up[u] = NONODE;
+    }
+
+    // iterator stuff
+    // -----------------------------------------------------------------------------------
+    // std::forward_iterator for iterating through all nodes
+    public: class Iterator_allnodes : public std::iterator<std::forward_iterator_tag, unsigned int> {
+        public: Iterator_allnodes(unsigned int idx_) : idx(idx_) { }
+        public: inline bool operator==(const Iterator_allnodes &r) { return idx == r.idx; }
+        public: inline bool operator!=(const Iterator_allnodes &r) { return idx != r.idx; }
+        public: inline Iterator_allnodes& operator++() {
+            ++idx;
+            return *this;
+        }
+        public: inline Iterator_allnodes operator++(int) {
+            Iterator_allnodes tmp(*this);
+            ++(*this);
+            return tmp;
+        }
+        public: inline unsigned int& operator*() { return idx; }
+        public: inline unsigned int* operator->() { return &idx; }
+        protected: unsigned int idx;
+    };
+    // default iterator is Iterator_allnodes (std::forward_iterator)
+    public: typedef Iterator_allnodes iterator;
+    public: typedef Iterator_allnodes const_iterator;
+    public: inline Iterator_allnodes begin() { return Iterator_allnodes(0); }
+    public: inline Iterator_allnodes end() { return Iterator_allnodes(node_size()); }
+
+    // -----------------------------------------------------------------------------------
+    // std::forward_iterator for iterating through the leaf (LEAF true) or internal nodes
+    public: template<bool LEAF> class Iterator_kindnodes : public Iterator_allnodes {
+        public: Iterator_kindnodes(unsigned int idx_, this_type *ptr_) : Iterator_allnodes(idx_), ptr(ptr_) {
+            if ((idx != ptr->node_size()) && (ptr->is_leaf(idx) != LEAF)) ++(*this);
+        }
+        public: inline Iterator_kindnodes& operator++() {
+            while (++idx < ptr->node_size()) if (ptr->is_leaf(idx) == LEAF) break;
+            return *this;
+        }
+        public: inline Iterator_kindnodes operator++(int) {
+            Iterator_kindnodes tmp(*this);
+            ++(*this);
+            return tmp;
+        }
+        protected: this_type *ptr;
+        public: using Iterator_allnodes::idx;
+    };
+    public: typedef Iterator_kindnodes<true> iterator_leafnodes;
+    public: typedef Iterator_kindnodes<true> const_iterator_leafnodes;
+    public: inline iterator_leafnodes begin_leafnodes() { return iterator_leafnodes(0,this); }
+    public: inline iterator_leafnodes end_leafnodes() { return iterator_leafnodes(node_size(),this); }
+    public: typedef Iterator_kindnodes<false> iterator_internalnodes;
+    public: typedef Iterator_kindnodes<false> const_iterator_internalnodes;
+    public: inline iterator_internalnodes begin_internalnodes() { return iterator_internalnodes(0,this); }
+    public: inline iterator_internalnodes end_internalnodes() { return iterator_internalnodes(node_size(),this); }
+
+    // -----------------------------------------------------------------------------------
+    // std::forward_iterator for iterating through all nodes according to DFS, the same steps
+    // (PREORDER, INORDER between the children and POSTORDER) as the one of TreeTemplate
+    // a DFS that stays below its start node (the one from the root, or from v with p its
+    // parent) walks along the parent and child arrays and allocates nothing; only one that
+    // walks up from its start node keeps the position in the adjacent nodes of every node on
+    // the path in a stack
+    public: class Iterator_dfs : public std::iterator<std::forward_iterator_tag, unsigned int> {
+        public: Iterator_dfs(unsigned int idx_, this_type *ptr_) : ptr(ptr_), idx(idx_), direction(NOTRAVERSAL) {
+            if (idx != ptr->node_size()) dfs_init();
+        }
+        public: Iterator_dfs(unsigned int idx_, this_type *ptr_, const unsigned int v, const unsigned int p = NONODE) : ptr(ptr_), idx(idx_), direction(NOTRAVERSAL) {
+            if (idx != ptr->node_size()) dfs_init(v,p);
+        }
+        public: inline bool operator==(const Iterator_dfs &r) { return idx == r.idx; }
+        public: inline bool operator!=(const Iterator_dfs &r) { return idx != r.idx; }
+        public: inline Iterator_dfs& operator++() {
+            dfs_next();
+            if (dfs_end()) idx = ptr->node_size();
+            return *this;
+        }
+        public: inline Iterator_dfs operator++(int) {
+            Iterator_dfs tmp(*this);
+            ++(*this);
+            return tmp;
+        }
+        public: inline unsigned int& operator*() { return idx; }
+        public: inline unsigned int* operator->() { return &idx; }
+        protected: this_type *ptr;
+        // DFS public
+        public: unsigned int idx;
+        public: unsigned int lvl;
+        public: unsigned int parent;
+        public: traversal_states direction;
+        // DFS interna
+        protected: bool walk;            // below the start node, without the stack
+        protected: unsigned int start;   // node the DFS started from
+        protected: unsigned int next;    // position of the child of idx to walk down to next (walk)
+        protected: struct dfs_item {
+            unsigned int v, parent, next, end; // next adjacent node to walk down to, end is the degree
+        };
+        protected: std::vector<dfs_item> dfs_stack;
+        protected: inline void dfs_push(const unsigned int v, const unsigned int p) {
+            dfs_item w;
+            w.v = v;
+            w.parent = p;
+            w.next = 0;
+            w.end = ptr->degree(v);
+            if ((w.next != w.end) && (ptr->adjacent_at(v, 0) == p)) ++w.next;
+            dfs_stack.push_back(w);
+        }
+        protected: inline void dfs_advance(dfs_item &w) {
+            ++w.next;
+            if ((w.next != w.end) && (ptr->adjacent_at(w.v, w.next) == w.parent)) ++w.next;
+        }
+        protected: inline void dfs_init(const unsigned int v, const unsigned int p) {
+            // fill the data structure with the start node
+            idx = start = v;
+            lvl = 0;
+            parent = p;
+            direction = PREORDER;
+            next = 0;
+            walk = (p == ptr->parent(v));
+            if (walk) return;
+            dfs_stack.reserve(log(ptr->node_size())/3/*3 = (10*log(2))*/);
+            dfs_push(v, p); // parent will be ignored in children
+        }
+        protected: inline void dfs_init() {
+            this_type &tree = *ptr;
+            unsigned int root;
+            if (tree.root == NONODE) {
+                WARNING("traversal without root node");
+                root = 0;
+            } else root = tree.root;
+            dfs_init(root, NONODE);
+        }
+        public: inline void skip() {
+            if (walk) {
+                next = ptr->children_size(idx);
+                return;
+            }
+            dfs_item &w = dfs_stack.back();
+            w.next = w.end;
+        }
+        protected: inline void dfs_finish() {
+            idx = UINT_MAX;
+            lvl = 0;
+            parent = UINT_MAX;
+            direction = NOTRAVERSAL;
+        }
+        protected: inline void walk_next() {
+            if (direction != POSTORDER) {
+                if (next == ptr->children_size(idx)) { // no more children
+                    direction = direction == PREORDER ? INORDER : POSTORDER;
+                    return;
+                }
+                parent = idx;
+                idx = ptr->child(idx, next);
+                next = 0;
+                ++lvl;
+                direction = PREORDER;
+                return;
+            }
+            if (idx == start) { // end of DFS
+                dfs_finish();
+                return;
+            }
+            const unsigned int c = idx;
+            idx = ptr->parent(c);
+            --lvl;
+            parent = idx == start ? NONODE : ptr->parent(idx);
+            next = ptr->child_position(idx, c) + 1;
+            direction = next == ptr->children_size(idx) ? POSTORDER : INORDER;
+        }
+        protected: inline void dfs_down(dfs_item &w) {
+            parent = idx;
+            idx = ptr->adjacent_at(w.v, w.next);
+            ++lvl;
+            dfs_push(idx, parent);
+        }
+        protected: inline void dfs_next() {
+            if (dfs_end()) return;
+            if (walk) {
+                walk_next();
+                return;
+            }
+            switch (direction) {
+                case PREORDER: { // last traversal step was preorder
+                    dfs_item &w = dfs_stack.back();
+                    if (w.next == w.end) direction = INORDER; // leaf
+                    else dfs_down(w);
+                } break;
+                case INORDER: { // last traversal step was inorder
+                    dfs_item &w = dfs_stack.back();
+                    if (w.next == w.end) direction = POSTORDER; // leaf
+                    else {
+                        direction = PREORDER;
+                        dfs_down(w);
+                    }
+                } break;
+                case POSTORDER: { // last traversal step was postorder
+                    dfs_stack.pop_back();
+                    if (dfs_stack.empty()) dfs_finish(); // end of DFS
+                    else { // more nodes in DFS
+                        dfs_item &w = dfs_stack.back();
+                        idx = w.v;
+                        --lvl;
+                        parent = dfs_stack.size() < 2 ? NONODE : dfs_stack[dfs_stack.size()-2].v;
+                        dfs_advance(w);
+                        direction = w.next == w.end ? POSTORDER : INORDER;
+                    }
+                } break;
+                default: ERROR_exit("broken traversal");
+            }
+        }
+        protected: inline bool dfs_end() { return direction == NOTRAVERSAL; }
+    };
+    public: typedef Iterator_dfs iterator_dfs;
+    public: typedef Iterator_dfs const_iterator_dfs;
+    public: inline Iterator_dfs begin_dfs() { return Iterator_dfs(0,this); }
+    public: inline Iterator_dfs begin_dfs(const unsigned int v) { return Iterator_dfs(0,this,v); }
+    public: inline Iterator_dfs begin_dfs(const unsigned int v, const unsigned int p) { return Iterator_dfs(0,this,v,p); }
+    public: inline Iterator_dfs end_dfs() { return Iterator_dfs(node_size(),this); }
+
+    // -----------------------------------------------------------------------------------
+    // std::forward_iterator for the steps of the DFS in one direction (PREORDER, INORDER or
+    // POSTORDER), or the EULERTOUR (internal nodes in every step, leaves once)
+    public: enum { EULERTOUR = NOTRAVERSAL + 1 };
+    public: template<int STEP> class Iterator_steps : public Iterator_dfs {
+        public: Iterator_steps(unsigned int idx_, this_type *ptr_) : Iterator_dfs(idx_,ptr_) {
+            if ((idx != ptr->node_size()) && !is_candidate()) ++(*this);
+        }
+        public: Iterator_steps(unsigned int idx_, this_type *ptr_, const unsigned int v, const unsigned int p = NONODE) : Iterator_dfs(idx_,ptr_,v,p) {
+            if ((idx != ptr->node_size()) && !is_candidate()) ++(*this);
+        }
+        private: inline bool is_candidate() {
+            if (STEP == EULERTOUR) return ((!ptr->is_leaf(idx)) || (direction == INORDER));
+            return (direction == STEP);
+        }
+        public: inline Iterator_steps& operator++() {
+            for (;;) {
+                dfs_next();
+                if (dfs_end()) {
+                    idx = ptr->node_size();
+                    break;
+                }
+                if (is_candidate()) break;
+            }
+            return *this;
+        }
+        public: inline Iterator_steps operator++(int) {
+            Iterator_steps tmp(*this);
+            ++(*this);
+            return tmp;
+        }
+        protected: using Iterator_dfs::ptr;
+        public: using Iterator_dfs::idx;
+        public: using Iterator_dfs::lvl;
+        public: using Iterator_dfs::parent;
+        public: using Iterator_dfs::direction;
+        protected: using Iterator_dfs::dfs_next;
+        protected: using Iterator_dfs::dfs_end;
+    };
+    public: typedef Iterator_steps<EULERTOUR> iterator_eulertour;
+    public: typedef Iterator_steps<EULERTOUR> const_iterator_eulertour;
+    public: inline iterator_eulertour begin_eulertour() { return iterator_eulertour(0,this); }
+    public: inline iterator_eulertour begin_eulertour(const unsigned int v) { return iterator_eulertour(0,this,v); }
+    public: inline iterator_eulertour begin_eulertour(const unsigned int v, const unsigned int p) { return iterator_eulertour(0,this,v,p); }
+    public: inline iterator_eulertour end_eulertour() { return iterator_eulertour(node_size(),this); }
+    public: typedef Iterator_steps<PREORDER> iterator_preorder;
+    public: typedef Iterator_steps<PREORDER> const_iterator_preorder;
+    public: inline iterator_preorder begin_preorder() { return iterator_preorder(0,this); }
+    public: inline iterator_preorder begin_preorder(const unsigned int v) { return iterator_preorder(0,this,v); }
+    public: inline iterator_preorder begin_preorder(const unsigned int v, const unsigned int p) { return iterator_preorder(0,this,v,p); }
+    public: inline iterator_preorder end_preorder() { return iterator_preorder(node_size(),this); }
+    public: typedef Iterator_steps<INORDER> iterator_inorder;
+    public: typedef Iterator_steps<INORDER> const_iterator_inorder;
+    public: inline iterator_inorder begin_inorder() { return iterator_inorder(0,this); }
+    public: inline iterator_inorder begin_inorder(const unsigned int v) { return iterator_inorder(0,this,v); }
+    public: inline iterator_inorder begin_inorder(const unsigned int v, const unsigned int p) { return iterator_inorder(0,this,v,p); }
+    public: inline iterator_inorder end_inorder() { return iterator_inorder(node_size(),this); }
+    public: typedef Iterator_steps<POSTORDER> iterator_postorder;
+    public: typedef Iterator_steps<POSTORDER> const_iterator_postorder;
+    public: inline iterator_postorder begin_postorder() { return iterator_postorder(0,this); }
+    public: inline iterator_postorder begin_postorder(const unsigned int v) { return iterator_postorder(0,this,v); }
+    public: inline iterator_postorder begin_postorder(const unsigned int v, const unsigned int p) { return iterator_postorder(0,this,v,p); }
+    public: inline iterator_postorder end_postorder() { return iterator_postorder(node_size(),this); }
+};
+
+typedef BinaryTreeTemplate<util::empty> BinaryTree;
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2011 Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TREE_EDGE_SAMPLER_H
+#define TREE_EDGE_SAMPLER_H
+
+#include "common.h"
+#include "tree_IO.h"
+#include "touched.h"
+#include <vector>
+#include <algorithm>
+
+namespace aw {
+
+using namespace std;
+
+// draws edges with probability proportional to their length
+// the edge of node v is the edge from v to its parent, its length is weights[v][0]
+// Fenwick tree (binary indexed tree) over the edge lengths
+// O(n) precomputation
+// O(log n) draw and update
+// O(changes) restore of a copy to its original
+class EdgeSampler {
+    protected: vector<double> fenwick; // fenwick[i] = sum of the lengths of nodes (i - lowbit(i), i]
+    protected: vector<double> length;  // length of the edge of each node
+    protected: unsigned int top;       // highest power of 2 <= capacity
+    protected: util::TouchedSet touched; // positions of fenwick and length changed since create() or restore()
+
+    // empty sampler for nodes 0..capacity-1
+    public: inline void create(const unsigned int capacity) {
+        fenwick.assign(capacity + 1, 0.0);
+        length.assign(capacity, 0.0);
+        touched.create(capacity + 1);
+        for (top = 1; (top << 1) <= capacity; top <<= 1);
+    }
+
+    // sampler for the edges of the nodes of a tree; capacity is the number of nodes the tree may grow to
+    public: template<class WEIGHTS> inline void create(const WEIGHTS &weights, const unsigned int capacity) {
+        create(capacity);
+        const unsigned int n_weights = weights.node_size();
+        if (n_weights > capacity) ERROR_exit("edge sampler too small for node " << n_weights - 1);
+        std::copy(weights.array().begin(), weights.array().end(), length.begin());
+        // linear time construction
+        const unsigned int n = length.size();
+        for (unsigned int i=1; i<=n; ++i) {
+            fenwick[i] += length[i-1];
+            const unsigned int j = i + (i & -i);
+            if (j <= n) fenwick[j] += fenwick[i];
+        }
+    }
+
+    // number of nodes the sampler can hold
+    public: inline unsigned int capacity() const { return length.size(); }
+
+    // length of the edge of node v
+    public: inline double weight(const unsigned int v) const { return length[v]; }
+
+    // change the length of the edge of node v
+    public: inline void set(const unsigned int v, const double w) {
+        const double d = w - length[v];
+        length[v] = w;
+        touched.touch(v);
+        for (unsigned int i=v+1,iEE=length.size(); i<=iEE; i+=(i & -i)) {
+            fenwick[i] += d;
+            touched.touch(i);
+        }
+    }
+
+    // undo all changes since this sampler was copied from base; base must be that original
+    public: inline void restore(const EdgeSampler &base) {
+        const unsigned int n = length.size();
+        for (unsigned int k=0,kEE=touched.size(); k<kEE; ++k) {
+            const unsigned int i = touched[k];
+            fenwick[i] = base.fenwick[i];
+            if (i < n) length[i] = base.length[i];
+        }
+        touched.clear();
+    }
+
+    // sum of the lengths of the edges of nodes 0..v-1
+    public: inline double prefix(const unsigned int v) const {
+        double s = 0;
+        for (unsigned int i=v; i>0; i-=(i & -i)) s += fenwick[i];
+        return s;
+    }
+
+    // total length of all edges
+    public: inline double total() const { return prefix(length.size()); }
+
+    // return the node whose edge covers position x in [0,total()) when the edges are laid out
+    // end to end in node order; offset is set to the position of x on that edge
+    public: inline unsigned int sample(double x, double &offset) const {
+        const unsigned int n = length.size();
+        unsigned int pos = 0;
+        for (unsigned int step=top; step>0; step>>=1) {
+            if ((pos + step <= n) && (fenwick[pos + step] <= x)) {
+                pos += step;
+                x -= fenwick[pos];
+            }
+        }
+        // rounding can push x past the last edge or onto an edge of length 0
+        while ((pos >= n) || ((length[pos] == 0) && (pos > 0))) {
+            --pos;
+            x = length[pos];
+        }
+        offset = x < 0 ? 0 : (x > length[pos] ? length[pos] : x);
+        return pos;
+    }
+
+    // like sample() without the edge of node v: x in [0,total()-weight(v)) is laid out over
+    // the other edges, so v is never drawn and no draw has to be repeated
+    public: inline unsigned int sample_excluding(double x, double &offset, const unsigned int v) const {
+        if (x >= prefix(v)) x += length[v];
+        const unsigned int pos = sample(x, offset);
+        if (pos != v) return pos;
+        // rounding moved the position onto v, take the closest edge of nonzero length
+        for (unsigned int u=v+1,uEE=length.size(); u<uEE; ++u) {
+            if (length[u] > 0) { offset = 0; return u; }
+        }
+        for (unsigned int u=v; u>0; --u) {
+            if (length[u-1] > 0) { offset = length[u-1]; return u-1; }
+        }
+        return pos;
+    }
+};
+
+} // namespace end
+
+#endif
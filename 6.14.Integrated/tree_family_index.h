@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2011 Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TREE_FAMILY_INDEX_H
+#define TREE_FAMILY_INDEX_H
+
+#include "common.h"
+#include "tree_IO.h"
+#include "tree_LCA.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <boost/unordered_map.hpp>
+
+namespace aw {
+
+using namespace std;
+
+// maps family names to their clades
+// a node belongs to a family if the family name is a substring of the node name,
+// the clade of a family is rooted at the MRCA of all its nodes
+// families are looked up by hashing the substrings of a name whose length is
+// between the shortest and the longest family name
+// O(n * l * (lmax - lmin)) precomputation, l = length of a node name
+class FamilyIndex {
+    protected: boost::unordered_map<string, unsigned int> ids;
+    protected: vector<string> names;
+    protected: vector<unsigned int> roots_; // MRCA of every family in the indexed tree, NONODE if absent
+    protected: size_t min_len, max_len;
+
+    public: FamilyIndex() : min_len(string::npos), max_len(0) {}
+
+    // id of a family, the family is added if it is new
+    public: inline unsigned int insert(const string &family) {
+        boost::unordered_map<string, unsigned int>::const_iterator itr = ids.find(family);
+        if (itr != ids.end()) return itr->second;
+        const unsigned int f = names.size();
+        ids[family] = f;
+        names.push_back(family);
+        roots_.push_back(NONODE);
+        min_len = std::min(min_len, family.size());
+        max_len = std::max(max_len, family.size());
+        return f;
+    }
+
+    // number of families
+    public: inline unsigned int size() const { return names.size(); }
+
+    // name of family f
+    public: inline const string &name(const unsigned int f) const { return names[f]; }
+
+    // ids of all families the node name belongs to, in increasing order
+    public: void matches(const string &name, vector<unsigned int> &fams) const {
+        fams.clear();
+        if (names.empty()) return;
+        for (size_t i=0,iEE=name.size(); i<iEE; ++i) {
+            for (size_t l=min_len; (l<=max_len) && (i+l<=iEE); ++l) {
+                boost::unordered_map<string, unsigned int>::const_iterator itr = ids.find(name.substr(i, l));
+                if (itr != ids.end()) fams.push_back(itr->second);
+            }
+        }
+        sort(fams.begin(), fams.end());
+        fams.erase(unique(fams.begin(), fams.end()), fams.end());
+    }
+
+    // locate the clades of all families in a tree, lca has to be created for that tree
+    // the root of a clade is the lca of its first and last member in the sequence of the lca,
+    // so the members only narrow down these two positions and each family takes one query
+    public: void create(const idx2name &node_names, const LCA &lca) {
+        const unsigned int n = names.size();
+        vector<unsigned int> first(n, NONODE), last(n, 0);
+        vector<unsigned int> fams;
+        for (unsigned int v=0,vEE=node_names.node_size(); v<vEE; ++v) {
+            const string *name = node_names.name(v);
+            if (name == NULL) continue;
+            matches(*name, fams);
+            const unsigned int pos = lca.position(v);
+            BOOST_FOREACH(const unsigned int &f, fams) {
+                if (pos < first[f]) first[f] = pos;
+                if (pos > last[f]) last[f] = pos;
+            }
+        }
+        roots_.assign(n, NONODE);
+        for (unsigned int f=0; f<n; ++f) if (first[f] != NONODE) roots_[f] = lca.lca_at(first[f], last[f]);
+    }
+
+    // root of the clade of family f in the indexed tree, NONODE if no node belongs to it
+    public: inline unsigned int root(const unsigned int f) const { return roots_[f]; }
+
+    // clade roots of all families, indexed by family id
+    public: inline const vector<unsigned int> &roots() const { return roots_; }
+};
+
+} // namespace end
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2011 Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TREE_NEWICK_H
+#define TREE_NEWICK_H
+
+#include "common.h"
+#include "input.h"
+#include "tree_IO.h"
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <math.h>
+
+namespace aw {
+
+using namespace std;
+
+// write v to out like "os << setprecision(precision) << v" (printf "%g") does and return the
+// number of characters; out needs room for 32 characters
+// numbers are scaled and rounded in floating point, printf is only needed when the rounding
+// is too close to call, for more than 12 digits and for very large or small exponents
+inline unsigned int format_double(const double v, const unsigned int precision, char *out) {
+    static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const int p = precision == 0 ? 1 : precision;
+    const double a = fabs(v);
+    if ((p <= 12) && (a >= 1e-300) && (a <= 1e300)) {
+        const double tolerance = pow10[p] * 1e-15; // well above the error of scaling
+        int e = (int)floor(log10(a)); // decimal exponent, may be off by one
+        for (unsigned int attempt=0; attempt<2; ++attempt) {
+            const int k = p - 1 - e;
+            if ((k > 22) || (k < -22)) break;
+            const double scaled = k >= 0 ? a * pow10[k] : a / pow10[-k];
+            const double fl = floor(scaled);
+            const double frac = scaled - fl;
+            if (fabs(frac - 0.5) < tolerance) break; // tie or close to it
+            unsigned long long digits = (unsigned long long)fl + (frac > 0.5 ? 1 : 0);
+            if (digits >= (unsigned long long)pow10[p]) { ++e; continue; }
+            if (digits < (unsigned long long)pow10[p-1]) { --e; continue; }
+            // p significant digits, the trailing zeros are dropped
+            char d[20];
+            for (int i=p-1; i>=0; --i) {
+                d[i] = '0' + (char)(digits % 10);
+                digits /= 10;
+            }
+            int nd = p;
+            while ((nd > 1) && (d[nd-1] == '0')) --nd;
+            char *o = out;
+            if (v < 0) *o++ = '-';
+            if ((e < -4) || (e >= p)) { // scientific
+                *o++ = d[0];
+                if (nd > 1) {
+                    *o++ = '.';
+                    for (int i=1; i<nd; ++i) *o++ = d[i];
+                }
+                *o++ = 'e';
+                int x = e;
+                if (x < 0) { *o++ = '-'; x = -x; } else *o++ = '+';
+                if (x >= 100) *o++ = '0' + (char)(x / 100);
+                *o++ = '0' + (char)((x / 10) % 10);
+                *o++ = '0' + (char)(x % 10);
+            } else
+            if (e < 0) { // 0.000ddd
+                *o++ = '0';
+                *o++ = '.';
+                for (int i=-1; i>e; --i) *o++ = '0';
+                for (int i=0; i<nd; ++i) *o++ = d[i];
+            } else { // ddd.ddd
+                for (int i=0; i<=e; ++i) *o++ = d[i];
+                if (nd > e + 1) {
+                    *o++ = '.';
+                    for (int i=e+1; i<nd; ++i) *o++ = d[i];
+                }
+            }
+            return o - out;
+        }
+    }
+    return snprintf(out, 32, "%.*g", p, v);
+}
+
+// append a weight to a newick string like weights_type::display_in_newick()
+template<class WEIGHT>
+inline void append_newick_weights(string &out, const WEIGHT &w, const unsigned int precision) {
+    char buf[32];
+    for (unsigned int i=0,iEE=w.size(); i<iEE; ++i) {
+        out += ':';
+        out.append(buf, format_double(w[i], precision, buf));
+    }
+}
+
+// newick text of a tree, formatted once, and the fragments of it that trees sharing the
+// nodes copy into their output: the label (name and weights) of every node and the whole
+// subtree below every node, as long as the subtree is unchanged
+class NewickLabels {
+    protected: string text;                        // newick of the tree without "[&U]" and ';'
+    protected: vector<unsigned int> begin_;        // subtree of v: text[begin_[v], end_[v])
+    protected: vector<unsigned int> label_begin;   // label of v: text[label_begin[v], end_[v])
+    protected: vector<unsigned int> end_;
+    protected: vector<unsigned int> name_length;
+    protected: vector<unsigned int> parent_;       // parent of v in the text
+    protected: unsigned int precision_;
+
+    protected: struct frame {
+        unsigned int v, parent, next;
+        bool first;
+        frame(const unsigned int v_, const unsigned int parent_) : v(v_), parent(parent_), next(0), first(true) {}
+    };
+
+    // same text as tree2newick() with the given precision
+    public: template<class TREE, class WEIGHTS> void create(TREE &tree, idx2name &names, WEIGHTS &weights, const unsigned int precision) {
+        const unsigned int n = tree.node_size();
+        precision_ = precision;
+        text.clear();
+        begin_.assign(n, 0);
+        label_begin.assign(n, 0);
+        end_.assign(n, 0);
+        name_length.assign(n, 0);
+        parent_.assign(n, NONODE);
+        vector<char> reached(n, 0);
+        if (n > 0) {
+            const unsigned int r = tree.root == NONODE ? 0 : tree.root;
+            vector<frame> stack;
+            stack.push_back(frame(r, NONODE));
+            reached[r] = 1;
+            if (!tree.is_leaf(r)) text += '(';
+            while (!stack.empty()) {
+                frame &f = stack.back();
+                const unsigned int v = f.v, deg = tree.degree(v);
+                while ((f.next < deg) && (tree.adjacent(v)[f.next] == f.parent)) ++f.next;
+                if (f.next < deg) { // next child
+                    const unsigned int c = tree.adjacent(v)[f.next++];
+                    if (!f.first && !tree.is_leaf(v)) text += ',';
+                    f.first = false;
+                    parent_[c] = v;
+                    reached[c] = 1;
+                    begin_[c] = text.size();
+                    stack.push_back(frame(c, v));
+                    if (!tree.is_leaf(c)) text += '(';
+                } else { // all children done
+                    if (!tree.is_leaf(v)) text += ')';
+                    append_label(v, names, weights);
+                    stack.pop_back();
+                }
+            }
+        }
+        // nodes not connected to the root only get their label
+        for (unsigned int v=0; v<n; ++v) {
+            if (reached[v]) continue;
+            begin_[v] = text.size();
+            append_label(v, names, weights);
+        }
+    }
+
+    // number of nodes
+    public: inline unsigned int size() const { return end_.size(); }
+
+    // number of significant digits of the weights
+    public: inline unsigned int precision() const { return precision_; }
+
+    // parent of node v in the text, NONODE for the root and nodes not connected to it
+    public: inline unsigned int parent(const unsigned int v) const { return parent_[v]; }
+
+    // append the name and the weights of node v
+    public: inline void append(string &out, const unsigned int v) const { out.append(text, label_begin[v], end_[v] - label_begin[v]); }
+
+    // append the name of node v
+    public: inline void append_name(string &out, const unsigned int v) const { out.append(text, label_begin[v], name_length[v]); }
+
+    // append the subtree of node v including the label of v
+    public: inline void append_subtree(string &out, const unsigned int v) const { out.append(text, begin_[v], end_[v] - begin_[v]); }
+
+    protected: template<class WEIGHTS> inline void append_label(const unsigned int v, idx2name &names, WEIGHTS &weights) {
+        label_begin[v] = text.size();
+        const string *name = names.name(v);
+        if (name != NULL) text += NS_input::getlegalstring(*name);
+        name_length[v] = text.size() - label_begin[v];
+        if (weights.size_of(v) != 0) append_newick_weights(text, weights[v], precision_);
+        end_[v] = text.size();
+    }
+};
+
+} // namespace end
+
+#endif
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2011 Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TREE_OVERLAY_H
+#define TREE_OVERLAY_H
+
+#include "common.h"
+#include "tree.h"
+#include "tree_IO.h"
+#include "tree_newick.h"
+#include "touched.h"
+#include <vector>
+#include <string>
+
+namespace aw {
+
+using namespace std;
+
+// modifiable view of a tree with names and weights that is never changed itself
+// (the base); the view only stores what differs from the base: new nodes, their names,
+// and copies of the adjacency lists and weights it changed (copy-on-write); the newick
+// text of the base is passed to newick() preformatted
+// several views can share a base, also from different threads
+// O(1) per change, O(changes) to reset the view to the base
+// O(nodes on the paths from the changes to the root) plus copying the text to write newick
+template<class TREE, class WEIGHTS>
+class TreeOverlay {
+    protected: typedef typename WEIGHTS::data_type weight_type;
+    protected: TREE *base;
+    protected: WEIGHTS *base_weights;
+    protected: unsigned int base_size, size;
+
+    protected: util::TouchedSet adj_touched;       // nodes with a copied adjacency list
+    protected: vector<unsigned int> adj_slot;       // node -> its list in adj
+    protected: vector<vector<unsigned int> > adj;   // lists are kept for reuse after a reset
+
+    protected: util::TouchedSet weight_touched;    // nodes with a copied weight
+    protected: vector<unsigned int> weight_slot;
+    protected: vector<weight_type> weights;
+
+    protected: vector<const string*> names;         // names of the new nodes, escaped for newick, or NULL
+
+    protected: struct frame {
+        unsigned int v, parent, next;
+        bool first;
+        frame(const unsigned int v_, const unsigned int parent_) : v(v_), parent(parent_), next(0), first(true) {}
+    };
+    protected: vector<frame> stack;
+    protected: util::TouchedSet dirty;             // base nodes with a change in their subtree
+
+    public: unsigned int root;
+
+    public: TreeOverlay() : base(NULL), base_weights(NULL), base_size(0), size(0), root(NONODE) {}
+
+    // empty view of a base; capacity is the number of nodes the tree may grow to
+    // the base is only read but has to outlive the view
+    public: void create(TREE &tree, WEIGHTS &tree_weights, const unsigned int capacity) {
+        base = &tree;
+        base_weights = &tree_weights;
+        base_size = size = tree.node_size();
+        root = tree.root;
+        const unsigned int n = std::max(capacity, base_size);
+        adj_touched.create(n);
+        adj_slot.assign(n, 0);
+        adj.clear();
+        weight_touched.create(n);
+        weight_slot.assign(n, 0);
+        weights.clear();
+        names.clear();
+        dirty.create(base_size);
+    }
+
+    // drop all changes
+    public: void reset() {
+        adj_touched.clear();
+        weight_touched.clear();
+        size = base_size;
+        root = base->root;
+        names.clear();
+    }
+
+    public: inline unsigned int node_size() const { return size; }
+    public: inline bool empty() const { return size == 0; }
+
+    // create a new node, it is disconnected from the tree
+    public: inline unsigned int new_node() {
+        const unsigned int v = size++;
+        if (size > adj_slot.size()) {
+            adj_touched.resize(2 * size);
+            adj_slot.resize(2 * size, 0);
+            weight_touched.resize(2 * size);
+            weight_slot.resize(2 * size, 0);
+        }
+        copy_adjacent(v);
+        names.push_back(NULL);
+        return v;
+    }
+
+    // adjacent nodes, same order as in the base tree after the same edge operations
+    public: inline unsigned int degree(const unsigned int v) {
+        return adj_touched.contains(v) ? adj[adj_slot[v]].size() : base->degree(v);
+    }
+    public: inline unsigned int adjacent(const unsigned int v, const unsigned int i) {
+        return adj_touched.contains(v) ? adj[adj_slot[v]][i] : base->adjacent(v)[i];
+    }
+    public: inline bool is_leaf(const unsigned int v) { return degree(v) <= 1; }
+
+    // connect 2 nodes with an edge
+    public: inline void add_edge(const unsigned int v, const unsigned int u) {
+        copy_adjacent(v).push_back(u);
+        copy_adjacent(u).push_back(v);
+    }
+
+    // remove an edge between 2 nodes, return false if the edge does not exist
+    public: inline bool remove_edge(const unsigned int v, const unsigned int u) {
+        if (!remove(copy_adjacent(v), u)) return false;
+        if (!remove(copy_adjacent(u), v)) return false;
+        return true;
+    }
+
+    // split the edge between selected and its parent offset above selected and hang a new
+    // leaf named name from the split point on an edge of length pendant; returns the new
+    // internal node, the new leaf is the node after it
+    // the name is not copied (see set_name())
+    public: unsigned int graft(const unsigned int selected, const unsigned int parent, const double offset, const double pendant, const string &name) {
+        const double reduce_length = weight(selected) - offset;
+        set_weight(selected, offset);
+        const unsigned int i_n = new_node();
+        set_weight(i_n, reduce_length);
+        const unsigned int l_n = new_node();
+        set_name(l_n, name);
+        remove_edge(parent, selected);
+        add_edge(i_n, selected);
+        add_edge(i_n, parent);
+        add_edge(i_n, l_n);
+        set_weight(l_n, pendant);
+        return i_n;
+    }
+
+    // the name of a new node, already escaped for newick (NS_input::getlegalstring); only its
+    // address is kept, so it has to stay unchanged until the view is reset
+    public: inline void set_name(const unsigned int v, const string &name) {
+        if (v < base_size) ERROR_exit("names of the base tree are read only");
+        names[v - base_size] = &name;
+    }
+
+    // first weight of the edge of node v, 0 if there is none
+    public: inline double weight(const unsigned int v) {
+        if (weight_touched.contains(v)) return weights[weight_slot[v]][0];
+        return base_weights->first(v);
+    }
+
+    // set the first weight of the edge of node v
+    public: inline void set_weight(const unsigned int v, const double w) {
+        copy_weight(v)[0] = w;
+    }
+
+    // append the tree in newick format to out, the same as tree2newick() of the changed tree
+    // if labels are the ones of the base with the default precision of 6 digits
+    // unchanged subtrees of the base are copied from labels, only the nodes above a change
+    // are written one by one
+    public: void newick(string &out, const NewickLabels &labels) {
+        if (size == 0) return;
+        unsigned int r = root;
+        if (r == NONODE) {
+            out += "[&U]";
+            r = 0;
+        }
+        mark_dirty(labels);
+        stack.clear();
+        if (unchanged(r, NONODE, labels)) {
+            labels.append_subtree(out, r);
+            out += ';';
+            return;
+        }
+        stack.push_back(frame(r, NONODE));
+        if (!is_leaf(r)) out += '(';
+        while (!stack.empty()) {
+            frame &f = stack.back();
+            const unsigned int v = f.v, deg = degree(v);
+            while ((f.next < deg) && (adjacent(v, f.next) == f.parent)) ++f.next;
+            if (f.next < deg) { // next child
+                const unsigned int c = adjacent(v, f.next++);
+                if (!f.first && !is_leaf(v)) out += ',';
+                f.first = false;
+                if (unchanged(c, v, labels)) {
+                    labels.append_subtree(out, c);
+                    continue;
+                }
+                stack.push_back(frame(c, v));
+                if (!is_leaf(c)) out += '(';
+            } else { // all children done
+                if (!is_leaf(v)) out += ')';
+                append_label(out, labels, v);
+                stack.pop_back();
+            }
+        }
+        out += ';';
+    }
+
+    // mark the base nodes whose subtree contains a changed node
+    protected: void mark_dirty(const NewickLabels &labels) {
+        dirty.clear();
+        for (unsigned int k=0,kEE=adj_touched.size(); k<kEE; ++k) {
+            for (unsigned int v=adj_touched[k]; (v < base_size) && !dirty.contains(v); v=labels.parent(v)) dirty.touch(v);
+        }
+        for (unsigned int k=0,kEE=weight_touched.size(); k<kEE; ++k) {
+            for (unsigned int v=weight_touched[k]; (v < base_size) && !dirty.contains(v); v=labels.parent(v)) dirty.touch(v);
+        }
+    }
+
+    // true if the subtree of v reached from parent is the one in the text of the base
+    protected: inline bool unchanged(const unsigned int v, const unsigned int parent, const NewickLabels &labels) {
+        return (v < base_size) && !dirty.contains(v) && (labels.parent(v) == parent);
+    }
+
+    protected: inline void append_label(string &out, const NewickLabels &labels, const unsigned int v) {
+        if (!weight_touched.contains(v)) {
+            if (v < base_size) labels.append(out, v);
+            else if (names[v - base_size] != NULL) out += *names[v - base_size];
+            return;
+        }
+        if (v < base_size) labels.append_name(out, v);
+        else if (names[v - base_size] != NULL) out += *names[v - base_size];
+        append_newick_weights(out, weights[weight_slot[v]], labels.precision());
+    }
+
+    // writable adjacency list of v, copied from the base on the first change
+    protected: inline vector<unsigned int> &copy_adjacent(const unsigned int v) {
+        if (adj_touched.contains(v)) return adj[adj_slot[v]];
+        const unsigned int s = adj_touched.size();
+        adj_touched.touch(v);
+        adj_slot[v] = s;
+        if (s == adj.size()) adj.push_back(vector<unsigned int>());
+        vector<unsigned int> &l = adj[s];
+        l.clear();
+        if (v < base_size) {
+            for (unsigned int i=0,iEE=base->degree(v); i<iEE; ++i) l.push_back(base->adjacent(v)[i]);
+        }
+        return l;
+    }
+
+    // writable weights of v, copied from the base on the first change
+    // (like WEIGHTS::operator[] this creates the weights of a node that had none)
+    protected: inline weight_type &copy_weight(const unsigned int v) {
+        if (weight_touched.contains(v)) return weights[weight_slot[v]];
+        const unsigned int s = weight_touched.size();
+        weight_touched.touch(v);
+        weight_slot[v] = s;
+        if (s == weights.size()) weights.push_back(weight_type());
+        weights[s] = (v < base_size) ? base_weights->get(v) : weight_type();
+        return weights[s];
+    }
+
+    // same order of the remaining nodes as AdjacentList::remove()
+    protected: static inline bool remove(vector<unsigned int> &l, const unsigned int u) {
+        for (unsigned int i=0,iEE=l.size(); i<iEE; ++i) {
+            if (l[i] == u) {
+                l[i] = l[iEE-1];
+                l.resize(iEE-1);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace end
+
+#endif
@@ -58,7 +58,7 @@ class SubtreeInfo {
             node_num = 0;
             leaf_num = 0;
             internal_num = 0;
-            TREE_DFS2(v,t) {
+            TREE_DFS_T(v, typename TREE, t) {
                 switch (v.direction) {
                     case PREORDER: {
                         ranges[v.idx].begin = node_num;
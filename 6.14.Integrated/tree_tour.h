@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2011 Avinash Ramu
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef TREE_TOUR_H
+#define TREE_TOUR_H
+
+#include "common.h"
+#include "tree.h"
+#include "touched.h"
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+namespace aw {
+
+using namespace std;
+
+// preorder sequence of a rooted tree that stays valid while leaves are grafted into edges
+// every subtree is a contiguous interval of the sequence, from its root to last(root),
+// so weighted sampling of the edges of a subtree is a range query
+// the sequence is kept in a treap (ordered by sequence position) whose elements are the
+// tree nodes themselves, every element stores the length of the edge to its parent
+// O(n) precomputation
+// O(log n) expected for graft, weight update, range sum and draw
+// O(changes) restore of a copy to its original
+class DynamicTour {
+    protected: vector<unsigned int> lc, rc, up; // treap structure
+    protected: vector<double> w, sum;           // edge length of the node / of its treap subtree
+    protected: vector<unsigned int> cnt;        // number of nodes in the treap subtree
+    protected: vector<unsigned int> last_;      // last node of the tree subtree in the sequence
+    protected: unsigned int root;               // treap root
+    protected: util::TouchedSet touched;        // nodes changed since create() or restore()
+
+    // treap priority; derived from the node id so the treap shape only depends on the node set
+    protected: static inline uint32_t priority(const unsigned int v) {
+        uint32_t h = v * 0x9E3779B1u;
+        h ^= h >> 16; h *= 0x85EBCA6Bu;
+        h ^= h >> 13; h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+    protected: inline double sum_of(const unsigned int v) const { return v == NONODE ? 0.0 : sum[v]; }
+    protected: inline unsigned int cnt_of(const unsigned int v) const { return v == NONODE ? 0 : cnt[v]; }
+    protected: inline void pull(const unsigned int v) {
+        touched.touch(v);
+        sum[v] = w[v] + sum_of(lc[v]) + sum_of(rc[v]);
+        cnt[v] = 1 + cnt_of(lc[v]) + cnt_of(rc[v]);
+    }
+
+    // sequence of the tree rooted at tree.root; capacity is the number of nodes the tree may grow to
+    public: template<class TREE, class WEIGHTS> void create(TREE &tree, const WEIGHTS &weights, const unsigned int capacity) {
+        lc.assign(capacity, NONODE);
+        rc.assign(capacity, NONODE);
+        up.assign(capacity, NONODE);
+        w.assign(capacity, 0.0);
+        sum.assign(capacity, 0.0);
+        cnt.assign(capacity, 0);
+        last_.assign(capacity, NONODE);
+        touched.create(capacity);
+        root = NONODE;
+        const unsigned int n_weights = weights.node_size();
+        if (n_weights > capacity) ERROR_exit("tour too small for node " << n_weights - 1);
+        std::copy(weights.array().begin(), weights.array().end(), w.begin());
+        // preorder sequence and the last node of every subtree
+        vector<unsigned int> seq; seq.reserve(tree.node_size());
+        unsigned int prev = NONODE;
+        for (typename TREE::iterator_dfs v=tree.begin_dfs(),vEE=tree.end_dfs(); v!=vEE; ++v) {
+            if (v.direction == PREORDER) {
+                seq.push_back(v.idx);
+                prev = v.idx;
+            } else
+            if (v.direction == POSTORDER) last_[v.idx] = prev;
+        }
+        // linear time treap construction (cartesian tree of the priorities)
+        vector<unsigned int> st; st.reserve(64);
+        BOOST_FOREACH(const unsigned int &x, seq) {
+            unsigned int l = NONODE;
+            while (!st.empty() && (priority(st.back()) < priority(x))) {
+                l = st.back();
+                st.pop_back();
+            }
+            lc[x] = l;
+            if (l != NONODE) up[l] = x;
+            if (!st.empty()) {
+                rc[st.back()] = x;
+                up[x] = st.back();
+            }
+            st.push_back(x);
+        }
+        if (!st.empty()) root = st.front();
+        // subtree sums (the treap has expected depth O(log n))
+        pull_all(root);
+        touched.clear();
+    }
+    protected: void pull_all(const unsigned int v) {
+        if (v == NONODE) return;
+        pull_all(lc[v]);
+        pull_all(rc[v]);
+        pull(v);
+    }
+
+    // last node of the subtree of v in the sequence
+    public: inline unsigned int last(const unsigned int v) const { return last_[v]; }
+
+    // length of the edge of node v
+    public: inline double weight(const unsigned int v) const { return w[v]; }
+
+    // change the length of the edge of node v
+    public: inline void set_weight(const unsigned int v, const double x) {
+        const double d = x - w[v];
+        w[v] = x;
+        for (unsigned int u=v; u!=NONODE; u=up[u]) {
+            sum[u] += d;
+            touched.touch(u);
+        }
+    }
+
+    // number of nodes before v in the sequence
+    public: inline unsigned int rank(const unsigned int v) const {
+        unsigned int r = cnt_of(lc[v]);
+        for (unsigned int u=v; up[u]!=NONODE; u=up[u]) {
+            const unsigned int p = up[u];
+            if (rc[p] == u) r += cnt_of(lc[p]) + 1;
+        }
+        return r;
+    }
+
+    // total edge length before v in the sequence
+    public: inline double before(const unsigned int v) const {
+        double s = sum_of(lc[v]);
+        for (unsigned int u=v; up[u]!=NONODE; u=up[u]) {
+            const unsigned int p = up[u];
+            if (rc[p] == u) s += sum_of(lc[p]) + w[p];
+        }
+        return s;
+    }
+
+    // total edge length of the subtree of c including the edge of c
+    public: inline double clade_weight(const unsigned int c) const {
+        const unsigned int l = last_[c];
+        return before(l) + w[l] - before(c);
+    }
+
+    // number of nodes in the subtree of c
+    public: inline unsigned int clade_size(const unsigned int c) const {
+        return rank(last_[c]) - rank(c) + 1;
+    }
+
+    // true if u is v or an ancestor of v
+    public: inline bool is_ancestor(const unsigned int u, const unsigned int v) const {
+        const unsigned int r = rank(v);
+        return (rank(u) <= r) && (r <= rank(last_[u]));
+    }
+
+    // node at sequence position k
+    public: inline unsigned int select(unsigned int k) const {
+        unsigned int u = root;
+        for (;;) {
+            const unsigned int l = cnt_of(lc[u]);
+            if (k < l) u = lc[u];
+            else if (k == l) return u;
+            else {
+                k -= l + 1;
+                u = rc[u];
+            }
+        }
+    }
+
+    // return the node whose edge covers position x in [0,clade_weight(c)) when the edges of the
+    // subtree of c are laid out end to end in sequence order; offset is set to the position on that edge
+    public: inline unsigned int sample(const unsigned int c, const double x, double &offset) const {
+        double y = before(c) + x;
+        unsigned int u = root, found;
+        for (;;) {
+            const double l = sum_of(lc[u]);
+            if ((y < l) && (lc[u] != NONODE)) {
+                u = lc[u];
+                continue;
+            }
+            y -= l;
+            if ((y < w[u]) || (rc[u] == NONODE)) {
+                found = u;
+                break;
+            }
+            y -= w[u];
+            u = rc[u];
+        }
+        // rounding can move the position just outside of the subtree
+        const unsigned int r = rank(found);
+        if (r < rank(c)) {
+            found = c;
+            y = 0;
+        } else
+        if (r > rank(last_[c])) {
+            found = last_[c];
+            y = w[found];
+        }
+        offset = y < 0 ? 0 : (y > w[found] ? w[found] : y);
+        return found;
+    }
+
+    // like sample() without the edge of c itself: x in [0,clade_weight(c)-weight(c)) covers the
+    // edges below c, which follow c in the sequence; c needs at least one child
+    public: inline unsigned int sample_below(const unsigned int c, const double x, double &offset) const {
+        const unsigned int found = sample(c, w[c] + x, offset);
+        if (found != c) return found;
+        // rounding moved the position back onto c, the first edge after it is the closest
+        offset = 0;
+        return select(rank(c) + 1);
+    }
+
+    // return the k-th node of the subtree of c, k in [0,clade_size(c))
+    public: inline unsigned int sample_uniform(const unsigned int c, const unsigned int k) const {
+        return select(rank(c) + k);
+    }
+
+    // insert the disconnected node x right before v in the sequence
+    protected: inline void insert_before(const unsigned int v, const unsigned int x) {
+        touched.touch(x);
+        lc[x] = rc[x] = NONODE;
+        w[x] = 0;
+        if (lc[v] == NONODE) {
+            lc[v] = x;
+            up[x] = v;
+            touched.touch(v);
+        } else { // rightmost node of the left subtree
+            unsigned int u = lc[v];
+            while (rc[u] != NONODE) u = rc[u];
+            rc[u] = x;
+            up[x] = u;
+            touched.touch(u);
+        }
+        for (unsigned int u=x; u!=NONODE; u=up[u]) pull(u);
+        while ((up[x] != NONODE) && (priority(up[x]) < priority(x))) rotate_up(x);
+    }
+    protected: inline void rotate_up(const unsigned int x) {
+        const unsigned int p = up[x];
+        const unsigned int g = up[p];
+        if (lc[p] == x) {
+            lc[p] = rc[x];
+            if (rc[x] != NONODE) { up[rc[x]] = p; touched.touch(rc[x]); }
+            rc[x] = p;
+        } else {
+            rc[p] = lc[x];
+            if (lc[x] != NONODE) { up[lc[x]] = p; touched.touch(lc[x]); }
+            lc[x] = p;
+        }
+        up[p] = x;
+        up[x] = g;
+        if (g == NONODE) root = x;
+        else {
+            if (lc[g] == p) lc[g] = x; else rc[g] = x;
+            touched.touch(g);
+        }
+        pull(p);
+        pull(x);
+    }
+
+    // the edge of selected gets subdivided by the new node i_n which also gets the new leaf l_n
+    // as a child; both new nodes start with edge length 0
+    public: inline void graft(const unsigned int selected, const unsigned int i_n, const unsigned int l_n) {
+        insert_before(selected, i_n);
+        insert_before(selected, l_n);
+        last_[i_n] = last_[selected];
+        last_[l_n] = l_n;
+    }
+
+    // undo all changes since this sequence was copied from base; base must be that original
+    public: inline void restore(const DynamicTour &base) {
+        for (unsigned int k=0,kEE=touched.size(); k<kEE; ++k) {
+            const unsigned int v = touched[k];
+            lc[v] = base.lc[v];
+            rc[v] = base.rc[v];
+            up[v] = base.up[v];
+            w[v] = base.w[v];
+            sum[v] = base.sum[v];
+            cnt[v] = base.cnt[v];
+            last_[v] = base.last_[v];
+        }
+        root = base.root;
+        touched.clear();
+    }
+};
+
+} // namespace end
+
+#endif
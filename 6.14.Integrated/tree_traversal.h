@@ -32,6 +32,23 @@
 #define TREE_POSTORDER2(VAL, tree) \
     for (aw::Tree::iterator_postorder VAL=(tree).begin_postorder(),itrEE=(tree).end_postorder(); VAL!=itrEE; ++(VAL))
 
+// the same for trees of type TREE_TYPE, e.g. TREE_POSTORDER_T(v, typename TREE, tree) in a template
+
+#define TREE_DFS_T(VAL, TREE_TYPE, tree) \
+    for (TREE_TYPE::iterator_dfs VAL=(tree).begin_dfs(),itrEE=(tree).end_dfs(); VAL!=itrEE; ++(VAL))
+
+#define TREE_EULERTOUR_T(VAL, TREE_TYPE, tree) \
+    for (TREE_TYPE::iterator_eulertour VAL=(tree).begin_eulertour(),itrEE=(tree).end_eulertour(); VAL!=itrEE; ++(VAL))
+
+#define TREE_PREORDER_T(VAL, TREE_TYPE, tree) \
+    for (TREE_TYPE::iterator_preorder VAL=(tree).begin_preorder(),itrEE=(tree).end_preorder(); VAL!=itrEE; ++(VAL))
+
+#define TREE_INORDER_T(VAL, TREE_TYPE, tree) \
+    for (TREE_TYPE::iterator_inorder VAL=(tree).begin_inorder(),itrEE=(tree).end_inorder(); VAL!=itrEE; ++(VAL))
+
+#define TREE_POSTORDER_T(VAL, TREE_TYPE, tree) \
+    for (TREE_TYPE::iterator_postorder VAL=(tree).begin_postorder(),itrEE=(tree).end_postorder(); VAL!=itrEE; ++(VAL))
+
 // -----------------------------------------------------------------------------------
 // -----------------------------------------------------------------------------------
 
@@ -199,6 +199,47 @@ namespace util {
         return true;
     }
 
+    // convert the text [begin,end) into value, same as convert(std::string(begin,end), value)
+    template<class T>
+    inline bool convert(const char *begin, const char *end, T &value) {
+        return convert(std::string(begin, end), value);
+    }
+
+    // numbers [+-]digits[.digits][(e|E)[+-]digits] with at most 2^53 as digits and a small power
+    // of 10 are exact doubles, so one multiplication or division rounds them correctly (Clinger's
+    // fast path) and gives the same value as the stream; anything else goes through the stream
+    inline bool convert(const char *begin, const char *end, double &value) {
+    #if defined(__FLT_EVAL_METHOD__) && (__FLT_EVAL_METHOD__ == 0)
+        static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+            1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const char *p = begin;
+        const bool negative = (p != end) && (*p == '-');
+        if ((p != end) && ((*p == '-') || (*p == '+'))) ++p;
+        unsigned long long m = 0;
+        int digits = 0, exponent = 0;
+        for (; (p != end) && (*p >= '0') && (*p <= '9'); ++p, ++digits) m = m * 10 + (*p - '0');
+        if ((p != end) && (*p == '.')) {
+            for (++p; (p != end) && (*p >= '0') && (*p <= '9'); ++p, ++digits, --exponent) m = m * 10 + (*p - '0');
+        }
+        if ((digits != 0) && (p != end) && ((*p == 'e') || (*p == 'E'))) {
+            ++p;
+            const bool negative_exponent = (p != end) && (*p == '-');
+            if ((p != end) && ((*p == '-') || (*p == '+'))) ++p;
+            int e = 0, e_digits = 0;
+            for (; (p != end) && (*p >= '0') && (*p <= '9') && (e_digits < 4); ++p, ++e_digits) e = e * 10 + (*p - '0');
+            if (e_digits == 0) p = begin; // not a number, let the stream decide
+            exponent += negative_exponent ? -e : e;
+        }
+        if ((p == end) && (digits != 0) && (digits <= 19) && (m <= (1ULL << 53)) && (exponent >= -22) && (exponent <= 22)) {
+            const double d = static_cast<double>(m);
+            value = exponent < 0 ? d / pow10[-exponent] : d * pow10[exponent];
+            if (negative) value = -value;
+            return true;
+        }
+    #endif
+        return convert(std::string(begin, end), value);
+    }
+
     // extract RGB from a string of the format "#rrggbb"
     inline bool extractRGB(const std::string &str, unsigned int &r, unsigned int &g, unsigned int &b) {
         // trim leading whitespace